@@ -1,35 +1,77 @@
 
+#include <csignal>
 #include "genesis.h"
 
+// set by SIGINT and SIGTERM, the world is saved on the way out
+static std::atomic<bool> stopping = false;
+
+// set by SIGUSR1, the trace rings are written between two ticks
+static std::atomic<bool> tracing = false;
 
 int main(int argc, char* argv[]) {
 
-  if (argc <= 1) {
+  if (argc <= 2) {
     std::cerr << "usage: " << (argc > 0 ? argv[0] : "<program>")
-        << " <world_name.json>" << std::endl;
+        << " <config.json> <world.json>" << std::endl;
     return -1;
   }
 
   std::error_code ec;
-  std::string file_name = std::filesystem::absolute(argv[1], ec);
+  std::string config_file_name = std::filesystem::absolute(argv[1], ec);
+
+  if (ec) {
+    std::cerr << "invalid path: " << ec.message().c_str() << std::endl;
+    return -1;
+  }
+
+  std::string world_file_name = std::filesystem::absolute(argv[2], ec);
 
   if (ec) {
     std::cerr << "invalid path: " << ec.message().c_str() << std::endl;
     return -1;
   }
 
+  struct sigaction action = {};
+  action.sa_handler = [](int) { stopping = true; };
+  sigaction(SIGINT, &action, nullptr);
+  sigaction(SIGTERM, &action, nullptr);
+
+  struct sigaction action_trace = {};
+  action_trace.sa_handler = [](int) { tracing = true; };
+  sigaction(SIGUSR1, &action_trace, nullptr);
+
   using namespace genesis_n;
 
   world_t world;
-  world.file_name = file_name;
+  world.config_file_name = config_file_name;
+  world.world_file_name  = world_file_name;
   world.init();
 
-  while (true) {
+  // every interval_stats_ms
+  uint64_t age_prev = world.stats.age;
+  auto     time_prev = std::chrono::steady_clock::now();
+  world.stats_hook = [&](world_t& world) {
+    auto   time_now = std::chrono::steady_clock::now();
+    double time_s   = std::chrono::duration<double>(time_now - time_prev).count();
+    std::cout << "age " << world.stats.age
+        << "   microbes_count " << world.stats.microbes_count
+        << "   ticks_per_s " << (world.stats.age - age_prev) / std::max(time_s, 1e-9)
+        << std::endl;
+    age_prev  = world.stats.age;
+    time_prev = time_now;
+  };
+
+  while (!stopping) {
     world.update();
+    if (tracing.exchange(false)) {
+      world.save_trace();
+    }
   }
 
+  world.save_data();
+  world.save_trace();
+
   std::cout << "end" << std::endl;
 
   return 0;
 }
-
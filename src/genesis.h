@@ -1,5 +1,7 @@
 
+#include <unordered_map>
 #include <unordered_set>
+#include <array>
 #include <filesystem>
 #include <iostream>
 #include <iomanip>
@@ -9,13 +11,30 @@
 #include <memory>
 #include <vector>
 #include <chrono>
+#include <condition_variable>
+#include <functional>
 #include <thread>
+#include <atomic>
+#include <mutex>
+#include <limits>
+#include <cstring>
 #include <regex>
+#include <span>
 #include <list>
 #include <set>
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef __x86_64__
+#include <immintrin.h>
+#endif
+
 #include "../3rd_party/nlohmann/json.hpp"
 #include "debug_logger.h"
+#include "trace_logger.h"
 
 
 
@@ -37,14 +56,18 @@
   #define LOG_GENESIS(name, ...)
 #else
   #define TRACE_GENESIS   \
-    DEBUG_LOGGER(utils_t::TRACE.c_str(),   \
-        logger_indent_genesis_t::indent,   \
-        utils_t::debug.contains(utils_t::TRACE))
+    TRACE_SCOPE(utils_t::CAT_TRACE, __FUNCTION__,   \
+        utils_t::debug_mask >> utils_t::CAT_TRACE & 1)
   #define LOG_GENESIS(name, ...)   \
-    DEBUG_LOG(utils_t::name.c_str(),   \
-        logger_indent_genesis_t::indent,   \
-        utils_t::debug.contains(utils_t::name),   \
-        __VA_ARGS__)
+    do {   \
+      if (utils_t::debug_mask >> utils_t::CAT_##name & 1) {   \
+        TRACE_EVENT(utils_t::CAT_##name, true, __VA_ARGS__);   \
+        DEBUG_LOG(utils_t::name.c_str(),   \
+            logger_indent_genesis_t::indent,   \
+            true,   \
+            __VA_ARGS__);   \
+      }   \
+    } while (0)
 #endif
 
 
@@ -58,6 +81,9 @@ struct logger_indent_genesis_t : debug_logger_n::indent_t<logger_indent_genesis_
 namespace genesis_n {
   struct config_t;
   struct world_t;
+  struct cell_t;
+  struct stats_t;
+  struct genome_t;
 
   using xy_pos_t    = std::pair<size_t, size_t>;
   using res_val_t   = int16_t;
@@ -85,19 +111,76 @@ namespace genesis_n {
     inline static size_t REG_RIP1B             = 0;
     inline static size_t REGS_SIZE_MIN         = 10;
     inline static size_t RES_ENERGY            = 0;
-
-    inline static size_t seed = {};
+    inline static uint64_t RAND_EMISSION       = 1ULL << 60;
+    inline static uint64_t RAND_SPAWN          = 2ULL << 60;
+    inline static uint64_t RAND_LOAD           = 3ULL << 60;
+    inline static size_t MIND_SWITCH           = 0;
+    inline static size_t MIND_THREADED         = 1;
+    inline static size_t WORLD_JSON            = 0;
+    inline static size_t WORLD_SNAPSHOT        = 1;
+    inline static size_t EMISSION_RANDOM       = 0;
+    inline static size_t EMISSION_EXPECTED     = 1;
+    inline static size_t SCHEDULE_FAST         = 0;
+    inline static size_t SCHEDULE_RATE         = 1;
+    inline static size_t SCHEDULE_BUDGET       = 2;
+    inline static size_t REPLAY_START          = 0;
+    inline static size_t REPLAY_CONFIG         = 1;
+    inline static size_t REPLAY_KEYFRAME       = 2;
+    inline static size_t PHASE_EMISSION        = 0;
+    inline static size_t PHASE_MIND            = 1;
+    inline static size_t PHASE_DEATH           = 2;
+    inline static size_t PHASE_SPAWN           = 3;
+    inline static size_t PHASE_SAVE            = 4;
+    inline static size_t PHASE_TICK            = 5;
+    inline static constexpr size_t PHASES_COUNT  = 6;
+    inline static constexpr size_t OPCODES_COUNT = 15;
+
+    inline static std::vector<std::string> mind_backends = { "switch", "threaded" };
+    inline static std::vector<std::string> world_formats = { "json", "snapshot" };
+    inline static std::vector<std::string> emissions     = { "random", "expected" };
+    inline static std::vector<std::string> schedules     = { "fast", "rate", "budget" };
+    inline static std::vector<std::string> replay_events = { "start", "config", "keyframe" };
+    inline static std::vector<std::string> phases        = {
+        "emission", "mind", "death", "spawn", "save", "tick" };
+    inline static std::vector<std::string> opcodes       = {
+        "nothing", "nop", "br", "br_abs", "set_u8", "set_u16", "add_u8", "sub_u8",
+        "turn", "look", "move", "clone", "recipe", "attack", "exchange" };
+
+    // opcode byte to its opcodes index, the bytes without an instruction are "nothing"
+    inline static constexpr std::array<uint8_t, 0x100> opcodes_ind = [] {
+      std::array<uint8_t, 0x100> opcodes_ind = {};
+      uint8_t cmds[] = { 0, 1, 2, 3, 4, 5, 6, 16, 17, 18, 19, 20, 21, 22 };
+      for (size_t ind{}; ind < std::size(cmds); ++ind) {
+        opcodes_ind[cmds[ind]] = ind + 1;
+      }
+      return opcodes_ind;
+    }();
 
     inline static std::set<std::string> debug = { ERROR };
 
+    // trace category ids of the LOG_GENESIS names, in the order of categories
+    inline static constexpr uint32_t CAT_TRACE = 0;
+    inline static constexpr uint32_t CAT_ARGS  = 1;
+    inline static constexpr uint32_t CAT_STATS = 2;
+    inline static constexpr uint32_t CAT_ERROR = 3;
+    inline static constexpr uint32_t CAT_DEBUG = 4;
+    inline static constexpr uint32_t CAT_MIND  = 5;
+    inline static constexpr uint32_t CAT_TIME  = 6;
+
+    inline static std::vector<std::string> categories = { TRACE, ARGS, STATS, ERROR, DEBUG, MIND, TIME };
+
+    // bit per category of debug, the string set is for the config
+    inline static uint64_t debug_mask = 1ULL << CAT_ERROR;
+
     inline static std::vector<std::string> directions = {
         DIR_R, DIR_U, DIR_U, DIR_LU, DIR_L, DIR_LD, DIR_D, DIR_RD };
 
-    static void rename(const std::string& name_old, const std::string& name_new);
+    static void set_debug(const std::set<std::string>& debug);
+    static bool rename(const std::string& name_old, const std::string& name_new);
     static void remove(const std::string& name);
     static bool load(nlohmann::json& json, const std::string& name, bool binary = false);
     static bool save(const nlohmann::json& json, const std::string& name, bool binary = false);
-    static uint64_t rand_u64();
+    static bool save_file(const std::string& name, std::span<const uint8_t> data);
     static uint64_t hash_mix(uint64_t h);
     static uint64_t fasthash64(const void *buf, size_t len, uint64_t seed);
 
@@ -112,14 +195,14 @@ namespace genesis_n {
       }
     }
 
-    static inline void load_data(auto& value, const std::vector<uint8_t>& data, uint64_t index) {
+    static inline void load_data(auto& value, std::span<const uint8_t> data, uint64_t index) {
       TRACE_GENESIS;
       auto dst = reinterpret_cast<void*>(&value);
       auto src = reinterpret_cast<const void*>(data.data() + (index % (data.size() - sizeof(value))));
       std::memcpy(dst, src, sizeof(value));
     }
 
-    static inline void save_data(auto value, std::vector<uint8_t>& data, uint64_t index) {
+    static inline void save_data(auto value, std::span<uint8_t> data, uint64_t index) {
       TRACE_GENESIS;
       auto dst = reinterpret_cast<void*>(data.data() + (index % (data.size() - sizeof(value))));
       auto src = reinterpret_cast<const void*>(&value);
@@ -127,6 +210,34 @@ namespace genesis_n {
     }
   };
 
+  // Counter-based generator: a draw is a pure function of (seed, tick, ind, counter),
+  // so results do not depend on the order or the thread cells are updated in.
+  struct rand_t {
+    inline static uint64_t GAMMA = 0x9E3779B97F4A7C15ULL;
+
+    uint64_t   key       = {};
+    uint64_t   counter   = {};
+
+    rand_t(uint64_t seed, uint64_t tick, uint64_t ind)
+      : key(mix(mix(mix(seed) ^ tick) ^ ind)) { }
+
+    uint64_t operator()() {
+      return mix(key + GAMMA * ++counter);
+    }
+
+    // the draw operator() returns when counter reaches the argument, without advancing it
+    uint64_t at(uint64_t counter_n) const {
+      return mix(key + GAMMA * counter_n);
+    }
+
+    static uint64_t mix(uint64_t z) {
+      z += GAMMA;
+      z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+      z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+      return z ^ (z >> 31);
+    }
+  };
+
   ////////////////////////////////////////////////////////////////////////////////
 
   struct config_json_wrapper_t {
@@ -134,27 +245,149 @@ namespace genesis_n {
 
     config_json_wrapper_t(config_t& config) : config(config) { }
     bool load(const std::string& file_name);
+    bool load(const nlohmann::json& json);
     bool save(const std::string& file_name);
+    void save(nlohmann::json& json);
+    uint64_t hash();
   };
 
   ////////////////////////////////////////////////////////////////////////////////
 
   struct world_json_wrapper_t {
+    using cells_t = std::vector<cell_t>;
+
     world_t&   world;
 
     world_json_wrapper_t(world_t& world) : world(world) { }
     bool load(const std::string& file_name);
     bool save(const std::string& file_name);
+    void copy(cells_t& cells);
+    static bool save(const std::string& file_name, cells_t& cells, const stats_t& stats, bool binary);
+  };
+
+  ////////////////////////////////////////////////////////////////////////////////
+
+  // Binary world file: the header, the resources_cell planes as they are in memory,
+  // a table of the distinct genomes and a table of the live microbes. Sections start
+  // at 8 byte aligned offsets, values are in host byte order.
+  struct snapshot_header_t {
+    inline static char       MAGIC[8]   = {'G', 'E', 'N', 'E', 'S', 'I', 'S', 'W'};
+    inline static uint32_t   VERSION    = 1;
+
+    char       magic[8]                 = {};
+    uint32_t   version                  = {};
+    uint32_t   header_size              = {};
+    uint64_t   config_hash              = {};
+    uint64_t   x_max                    = {};
+    uint64_t   y_max                    = {};
+    uint64_t   resources_count          = {};
+    uint64_t   code_size                = {};
+    uint64_t   regs_size                = {};
+    uint64_t   genomes_count            = {};
+    uint64_t   genome_size              = {}; // family, then code_size bytes
+    uint64_t   microbes_count           = {};
+    uint64_t   microbe_size             = {}; // snapshot_microbe_t, resources, then regs
+    uint64_t   resources_offset         = {};
+    uint64_t   genomes_offset           = {};
+    uint64_t   microbes_offset          = {};
+    uint64_t   file_size                = {};
+    uint64_t   stats_age                = {};
+    uint64_t   stats_microbes_count     = {};
+    double     stats_microbes_age_avg   = {};
+    uint64_t   stats_instructions       = {};
+  };
+
+  struct snapshot_microbe_t {
+    uint32_t    ind                = {};
+    uint32_t    genome             = {};
+    res_val_t   age                = {};
+    uint8_t     direction          = {};
+    int8_t      energy_remaining   = {};
+  };
+
+  // Delta checkpoint: the rows of the tiles that changed since the previous checkpoint of
+  // the chain, a span being one row of one tile, tile * tile_size + the row in it. Per span
+  // the resources_cell row of every resource, then the genomes and microbe records of the
+  // live microbes in those spans as in a snapshot.
+  struct delta_header_t {
+    inline static char       MAGIC[8]   = {'G', 'E', 'N', 'E', 'S', 'I', 'S', 'D'};
+    inline static uint32_t   VERSION    = 2;
+
+    char       magic[8]                 = {};
+    uint32_t   version                  = {};
+    uint32_t   header_size              = {};
+    uint64_t   config_hash              = {};
+    uint64_t   x_max                    = {};
+    uint64_t   y_max                    = {};
+    uint64_t   resources_count          = {};
+    uint64_t   code_size                = {};
+    uint64_t   regs_size                = {};
+    uint64_t   tile_size                = {};
+    uint64_t   base_age                 = {}; // stats.age of the full save the chain starts at
+    uint64_t   sequence                 = {}; // 1 for the first delta after the full save
+    uint64_t   spans_count              = {};
+    uint64_t   genomes_count            = {};
+    uint64_t   genome_size              = {};
+    uint64_t   microbes_count           = {};
+    uint64_t   microbe_size             = {};
+    uint64_t   spans_offset             = {};
+    uint64_t   resources_offset         = {};
+    uint64_t   genomes_offset           = {};
+    uint64_t   microbes_offset          = {};
+    uint64_t   file_size                = {};
+    uint64_t   stats_age                = {};
+    uint64_t   stats_microbes_count     = {};
+    double     stats_microbes_age_avg   = {};
+    uint64_t   stats_instructions       = {};
+  };
+
+  struct world_snapshot_wrapper_t {
+    using genomes_t     = std::vector<const genome_t*>;
+    using genomes_ind_t = std::unordered_map<const genome_t*, uint32_t>;
+    using reader_t      = std::function<bool(std::span<const uint8_t>)>;
+
+    world_t&   world;
+
+    world_snapshot_wrapper_t(world_t& world) : world(world) { }
+    bool load(const std::string& file_name);
+    bool load(std::span<const uint8_t> data);
+    bool save(const std::string& file_name);
+    void save(std::vector<uint8_t>& data);
+    bool load_delta(const std::string& file_name, uint64_t base_age, uint64_t sequence);
+    bool load_delta(std::span<const uint8_t> data, uint64_t base_age, uint64_t sequence);
+    void save_delta(std::vector<uint8_t>& data, uint64_t base_age, uint64_t sequence);
+    void save_genomes(const std::vector<uint32_t>& live, genomes_t& genomes, genomes_ind_t& genomes_ind);
+    void save_genome(uint8_t* record, const genome_t* genome);
+    void save_microbe(uint8_t* record, size_t ind, uint32_t genome);
+    genomes_t load_genomes(const uint8_t* records, size_t count, size_t size);
+    bool load_microbe(const uint8_t* record, const genomes_t& genomes);
+    static bool map_file(const std::string& file_name, const reader_t& reader);
+    static bool is_snapshot(const std::string& file_name);
+    static bool load_header(const std::string& file_name, snapshot_header_t& header);
+    static std::string delta_file_name(const std::string& file_name, uint64_t sequence);
+    static void remove_deltas(const std::string& file_name);
   };
 
   ////////////////////////////////////////////////////////////////////////////////
 
+  // A source of a resource around pos. The random emission adds the kernel at frequency *
+  // 3.14 * radius^2 random draws a tick; the expected one adds the expected delta of those
+  // draws to every cell of the (2 * radius)^2 box. A draw costs about 12 ns and a cell of the
+  // box about 0.4 ns, bound by memory, so below a frequency of about 0.04 the expected
+  // emission costs more than the draws it replaces and is only worth its smoothness.
   struct area_t {
     xy_pos_t      pos               = {};
     size_t        radius            = 100;
     double        frequency         = 0.01;
     double        factor            = 1;
     double        sigma             = 2;
+    size_t        emission          = 0; // utils_t::emissions
+    bool          stochastic_rounding = false; // of the expected emission, instead of dithering
+
+    std::vector<int32_t> kernel     = {}; // resource delta by |dx| + |dy| * (radius + 1)
+    std::vector<int32_t> expected   = {}; // 16.16 expected delta per tick, (2 * radius)^2 row-major
+
+    void init_kernel();
   };
 
   struct resource_info_t {
@@ -173,11 +406,142 @@ namespace genesis_n {
     in_out_t      in_out      = {};
   };
 
+  // ns over the profiler window
+  struct phase_stats_t {
+    uint64_t   p50   = {};
+    uint64_t   p99   = {};
+    uint64_t   max   = {};
+  };
+
   struct stats_t {
     uint64_t   age              = {};
     uint64_t   microbes_count   = {};
     double     microbes_age_avg = {};
     uint64_t   time_update      = {};
+    uint64_t   instructions     = {};
+    uint64_t   time_save_stall  = {}; // us the simulation waited for the last save
+    uint64_t   time_save_write  = {}; // us the writer thread took for the last save
+    uint64_t   time_emission    = {}; // us of the last tick spent on resource emission
+    uint64_t   deaths           = {};
+    uint64_t   time_death       = {}; // ns of the last tick spent on dying microbes, summed over threads
+
+    std::array<uint64_t, utils_t::OPCODES_COUNT>      opcodes = {}; // instructions of the last tick
+    std::array<phase_stats_t, utils_t::PHASES_COUNT>  phases  = {}; // see profiler_t
+  };
+
+  // Rolling window of the last WINDOW durations of every phase of the tick, ns. Recording a
+  // phase is a clock read and a store; the window is sorted into the percentiles of
+  // stats_t::phases every REFRESH ticks, and every tick while it is short.
+  struct profiler_t {
+    inline static constexpr size_t WINDOW  = 1024;
+    inline static constexpr size_t REFRESH = 64;
+
+    using window_t = std::array<uint64_t, WINDOW>;
+
+    std::array<window_t, utils_t::PHASES_COUNT>  samples  = {};
+    std::array<uint64_t, utils_t::PHASES_COUNT>  count    = {};
+    uint64_t                                     ticks    = {};
+
+    static uint64_t now() {
+      return std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    void record(size_t phase, uint64_t ns) {
+      samples[phase][count[phase]++ % WINDOW] = ns;
+    }
+
+    // records the phase that started at time_beg, returns its end, the start of the next one
+    uint64_t lap(size_t phase, uint64_t time_beg) {
+      uint64_t time_end = now();
+      record(phase, time_end - time_beg);
+      return time_end;
+    }
+
+    void refresh(stats_t& stats);
+  };
+
+  // Paces the ticks and the periodic tasks on steady_clock, so a jump of the wall clock moves
+  // neither. SCHEDULE_FAST ticks back to back. SCHEDULE_RATE ticks every 1 / ticks_per_s and
+  // catches up on the ticks it is late for, unless it is more than BACKLOG_MAX late.
+  // SCHEDULE_BUDGET ticks back to back until ticks_per_s ticks were made in the current
+  // second, then waits for the next one. A task that returns false, a save while the last one
+  // is still written, is retried WAIT_MAX later.
+  struct scheduler_t {
+    using clock_t     = std::chrono::steady_clock;
+    using task_run_t  = std::function<bool(clock_t::time_point now)>;
+
+    inline static constexpr clock_t::duration BACKLOG_MAX = std::chrono::seconds(1);
+    inline static constexpr clock_t::duration WAIT_MAX    = std::chrono::milliseconds(10);
+
+    struct task_t {
+      clock_t::duration     interval   = {};
+      clock_t::time_point   due        = {};
+      task_run_t            run        = {};
+    };
+
+    size_t                  schedule       = {};
+    size_t                  ticks_per_s    = {};
+    clock_t::duration       period         = {};
+    clock_t::time_point     tick_due       = {}; // rate: the next tick
+    clock_t::time_point     window_end     = {}; // budget: the end of the current second
+    size_t                  window_ticks   = {}; // budget: ticks made in it
+    clock_t::time_point     tick_last      = {};
+    std::vector<task_t>     tasks          = {};
+
+    void init(size_t schedule, size_t ticks_per_s);
+    size_t add(size_t interval_ms, task_run_t run);
+    bool tick_ready(clock_t::time_point now);
+    void tick_done(clock_t::time_point now);
+    void run_tasks(clock_t::time_point now);
+    void wait(clock_t::time_point now);
+
+    // the task is due again interval from now
+    void postpone(size_t task, clock_t::time_point now) {
+      tasks[task].due = now + tasks[task].interval;
+    }
+  };
+
+  // Replay log of a world, in <world file>.replay: enough to re-simulate any of its ticks
+  // exactly. A tick is a function of the cells, the config and the seed alone, rand_t is
+  // keyed by seed, tick and cell, so the log holds the seed and the config of the start,
+  // the config reloads, and a keyframe snapshot every replay_keyframe_ticks to replay
+  // from. Spawns are drawn from the seed and need no entry. An entry per line of LOG_FILE,
+  // each with the snapshot and the world_t::hash of its age:
+  //
+  //   {"event":"start",    "age":A, "seed":S, "config_hash":C, "config":{..}, "snapshot":F, "hash":H}
+  //   {"event":"config",   "age":A, "config_hash":C, "config":{..}, "snapshot":F, "hash":H}
+  //   {"event":"keyframe", "age":A, "snapshot":F, "hash":H}
+  //
+  // A world restarted from an older save appends a start of its own; the ticks from there
+  // on replay from the new run, the ticks before it from the old one.
+  //
+  // The snapshots are written by the world_t writer, the entry once its snapshot is on disk.
+  // The starts and the configs stay; the last replay_keyframes keyframes of the run stay
+  // at every replay_keyframe_ticks, the older ones at twice the spacing of the ones after
+  // them for every replay_keyframes of them: a seek far back replays more ticks, and a long
+  // run keeps a number of keyframes that grows with the log of its length.
+  struct replay_log_t {
+    using entries_t = std::vector<nlohmann::json>;
+
+    inline static std::string LOG_FILE = "replay.jsonl";
+
+    std::string             dir_name    = {};
+    std::ofstream           log         = {}; // of the writer, once open
+    bool                    opened      = {};
+    std::vector<uint64_t>   keyframes   = {}; // ages of the keyframes of this run on disk
+
+    static std::string dir(const std::string& world_file_name) {
+      return world_file_name + ".replay";
+    }
+
+    bool open(world_t& world);
+    bool record(world_t& world, size_t event);
+    void update(world_t& world);
+    std::set<std::string> thin(uint64_t keyframe_ticks, size_t keep);
+    bool prune(const std::set<std::string>& snapshots);
+    static bool load(const std::string& dir_name, entries_t& entries);
+    static bool seek(const std::string& dir_name, uint64_t age, world_t& world);
   };
 
   ////////////////////////////////////////////////////////////////////////////////
@@ -190,14 +554,15 @@ namespace genesis_n {
     data_t        code;
     data_t        regs;
     uint64_t      family; // TODO type
+    size_t        genome               = {}; // world file genomes index, used when code is empty
     resources_t   resources;
     xy_pos_t      pos;
     res_val_t     age;
     uint8_t       direction;
     int8_t        energy_remaining;
 
-    void init(const config_t& config);
-    bool validation(const config_t& config);
+    void init(const config_t& config, rand_t& rand);
+    bool validation(const config_t& config, rand_t& rand);
   };
 
   struct recipe_t {
@@ -221,8 +586,15 @@ namespace genesis_n {
     size_t        age_max; // XXX type
     size_t        age_max_delta;
     size_t        energy_remaining;
-    size_t        interval_update_world_ms;
+    size_t        interval_update_world_ms; // deprecated, the default of schedule and ticks_per_s
     size_t        interval_save_world_ms;
+    size_t        interval_checkpoint_ms; // delta checkpoints between saves, 0 disables
+    size_t        interval_stats_ms; // world_t::stats_hook, 0 disables
+    size_t        schedule;
+    size_t        ticks_per_s; // of SCHEDULE_RATE and SCHEDULE_BUDGET
+    size_t        replay_keyframe_ticks; // replay_log_t keyframes, 0 disables the log
+    size_t        replay_keyframes; // replay_log_t keyframes at full spacing, 0 keeps them all
+    size_t        hash_log_ticks; // world_t::hash_tiles to <world file>.hashes, 0 disables
     double        mutation_probability;
     size_t        seed;
     debug_t       debug;
@@ -236,6 +608,10 @@ namespace genesis_n {
     size_t        spawn_min_count;
     size_t        spawn_max_count;
     bool          binary_data; // deprecated
+    size_t        update_threads;
+    size_t        update_tile_size;
+    size_t        mind_backend;
+    size_t        world_format;
   };
 
   struct cell_t {
@@ -245,8 +621,242 @@ namespace genesis_n {
     resources_t   resources;
   };
 
+  ////////////////////////////////////////////////////////////////////////////////
+
+  // One batch of emission draws of an area: the offsets drawn in [0, 2 * radius) go in,
+  // the cell indices and the kernel deltas come out, npos for draws outside the world.
+  struct emission_batch_t {
+    inline static constexpr size_t   SIZE   = 256;
+    inline static constexpr uint32_t npos   = std::numeric_limits<uint32_t>::max();
+#ifdef __x86_64__
+    inline static bool               avx2   = __builtin_cpu_supports("avx2");
+#else
+    inline static bool               avx2   = false;
+#endif
+
+    size_t                       count      = {};
+    std::array<uint32_t, SIZE>   offset_x   = {};
+    std::array<uint32_t, SIZE>   offset_y   = {};
+    std::array<uint32_t, SIZE>   ind        = {};
+    std::array<int32_t, SIZE>    delta      = {};
+
+    void resolve(const area_t& area, size_t x_max, size_t y_max);
+    void resolve_scalar(const area_t& area, size_t x_max, size_t y_max, size_t beg);
+    void resolve_avx2(const area_t& area, size_t x_max, size_t y_max);
+  };
+
+  ////////////////////////////////////////////////////////////////////////////////
+
+  template <typename T>
+  struct plane_ref_t {
+    T*       data     = {};
+    size_t   stride   = {};
+    size_t   count    = {};
+
+    T& operator[](size_t ind) const {
+      return data[ind * stride];
+    }
+
+    size_t size() const {
+      return count;
+    }
+  };
+
+  struct microbe_ref_t {
+    using resources_t   = plane_ref_t<res_val_t>;
+    using code_t        = std::span<const uint8_t>;
+    using data_t        = std::span<uint8_t>;
+
+    uint8_t&      alive;
+    code_t        code;
+    data_t        regs;
+    uint64_t&     family;
+    resources_t   resources;
+    xy_pos_t      pos;
+    res_val_t&    age;
+    uint8_t&      direction;
+    int8_t&       energy_remaining;
+
+    void init(const config_t& config, rand_t& rand);
+    bool validation(const config_t& config);
+  };
+
+  struct cell_ref_t {
+    using resources_t = plane_ref_t<res_val_t>;
+
+    microbe_ref_t   microbe;
+    resources_t     resources;
+  };
+
+  struct regs_arena_t {
+    using chunk_t    = std::vector<uint8_t>;
+    using chunks_t   = std::vector<chunk_t>;
+    using free_t     = std::vector<uint32_t>;
+
+    inline static uint32_t   npos          = std::numeric_limits<uint32_t>::max();
+    inline static size_t     chunk_slots   = 4096;
+
+    size_t       regs_size   = {};
+    chunks_t     chunks      = {}; // chunk_slots slots of regs_size bytes, never moved
+    free_t       free        = {};
+    std::mutex   mutex       = {}; // tile workers alloc and release concurrently
+
+    void init(size_t slots_max, size_t regs_size);
+    uint32_t alloc();
+    void release(uint32_t slot);
+
+    std::span<uint8_t> regs(uint32_t slot) {
+      return {chunks[slot / chunk_slots].data() + (slot % chunk_slots) * regs_size, regs_size};
+    }
+  };
+
+  // Operands of the instruction at one rip. The opcode itself is read from the registers
+  // at run time, so only its register index and the code bytes after it can be decoded.
+  // The SET_U16 value is read from the code, its index wraps at code_size - 2 and not with rip.
+  struct decoded_op_t {
+    uint8_t    cmd        = {}; // regs index of the opcode
+    uint8_t    reg[3]     = {}; // regs index of an uint8_t operand
+    uint8_t    reg16[3]   = {}; // regs index of an uint16_t operand
+    uint8_t    val8       = {}; // SET_U8 value
+  };
+
+  // Immutable code shared by all the live microbes of a family. The operands are decoded
+  // on the first use by the threaded interpreter, the switch one never reads them.
+  struct genome_t {
+    using code_t = std::vector<uint8_t>;
+    using ops_t  = std::vector<decoded_op_t>;
+
+    uint64_t                    family    = {}; // fasthash64 of the code
+    mutable size_t              refs      = {}; // guarded by genome_store_t::mutex
+    code_t                      code      = {};
+    mutable ops_t               ops       = {}; // indexed by rip % ops.size(), once decoded
+    mutable std::atomic<bool>   decoded   = {};
+  };
+
+  // Interned genomes: a clone shares its parent's genome unless a code byte mutated,
+  // and a genome is released with the last microbe that uses it. Keyed by family, the
+  // code tells apart the genomes of colliding families.
+  struct genome_store_t {
+    using genomes_t = std::unordered_multimap<uint64_t, genome_t>;
+
+    size_t       code_size   = {};
+    size_t       regs_size   = {};
+    size_t       ops_size    = {}; // period of the operands in rip, a power of two up to 0x100
+    genomes_t    genomes     = {};
+    std::mutex   mutex       = {}; // tile workers intern and release concurrently
+
+    void init(size_t code_size, size_t regs_size);
+    const genome_t* intern(std::span<const uint8_t> code);
+    const genome_t* intern(uint64_t family, std::span<const uint8_t> code);
+    const genome_t* acquire(const genome_t* genome);
+    void release(const genome_t* genome);
+    const genome_t::ops_t& ops(const genome_t* genome);
+    void decode(const genome_t& genome);
+
+    size_t size() const {
+      return genomes.size();
+    }
+  };
+
+  struct cells_soa_t {
+    template <typename T>
+    using plane_t = std::vector<T>;
+
+    inline static constexpr uint8_t DIRTY_CHECKPOINT = 1; // changed since the last checkpoint
+    inline static constexpr uint8_t DIRTY_HASH       = 2; // changed since tiles_hash was computed
+
+    size_t                count              = {};
+    size_t                x_max              = {};
+    size_t                resources_count    = {};
+    size_t                code_size          = {};
+    size_t                regs_size          = {};
+
+    plane_t<uint8_t>      alive              = {};
+    plane_t<uint64_t>     family             = {};
+    plane_t<res_val_t>    age                = {};
+    plane_t<uint8_t>      direction          = {};
+    plane_t<int8_t>       energy_remaining   = {};
+    plane_t<res_val_t>    resources_microbe  = {}; // resources_count planes of count cells
+    plane_t<res_val_t>    resources_cell     = {}; // resources_count planes of count cells
+    plane_t<uint32_t>     slot               = {}; // regs_arena_t slot, npos for dead cells
+    regs_arena_t          arena              = {};
+    plane_t<const genome_t*> genome          = {}; // genome_store_t entry, nullptr for dead cells
+    genome_store_t        genomes            = {};
+    plane_t<uint32_t>     live_slot          = {}; // position in live, npos for dead cells
+    std::vector<uint32_t> live               = {}; // indices of the live cells, unordered
+    bool                  live_tracking      = true;
+    size_t                tile_size          = {};
+    size_t                tiles_x            = {};
+    size_t                tiles_y            = {};
+    plane_t<uint8_t>      tiles_dirty        = {}; // DIRTY_ bits of every tile
+    plane_t<uint8_t>      rows_dirty         = {}; // DIRTY_CHECKPOINT of every row of every tile
+    plane_t<uint64_t>     tiles_hash         = {}; // world_t::hash_tiles of every tile
+
+    void init(const config_t& config);
+    void alloc(size_t ind);
+    void kill(size_t ind);
+    void set_genome(size_t ind, const genome_t* genome);
+    void swap_microbes(size_t ind1, size_t ind2);
+    void rebuild_live(const std::vector<uint32_t>& live_prev);
+    void mark_dirty(size_t ind, size_t radius);
+    void mark_dirty_all();
+    void clear_dirty();
+    void load_microbe(size_t ind, const microbe_t& microbe);
+    void save_microbe(size_t ind, microbe_t& microbe);
+    void load(size_t ind, const cell_t& cell);
+    void save(size_t ind, cell_t& cell);
+
+    size_t size() const {
+      return count;
+    }
+
+    cell_ref_t operator[](size_t ind) {
+      bool has_slot = slot[ind] != regs_arena_t::npos;
+      return {
+        .microbe = {
+          .alive              = alive[ind],
+          .code               = genome[ind] ? std::span(genome[ind]->code) : std::span<const uint8_t>{},
+          .regs               = has_slot ? arena.regs(slot[ind]) : std::span<uint8_t>{},
+          .family             = family[ind],
+          .resources          = {resources_microbe.data() + ind, count, resources_count},
+          .pos                = {ind % x_max, ind / x_max},
+          .age                = age[ind],
+          .direction          = direction[ind],
+          .energy_remaining   = energy_remaining[ind],
+        },
+        .resources = {resources_cell.data() + ind, count, resources_count},
+      };
+    }
+  };
+
+  struct thread_pool_t {
+    using task_t      = std::function<void(size_t)>;
+    using threads_t   = std::vector<std::thread>;
+
+    threads_t                 threads       = {};
+    std::mutex                mutex         = {};
+    std::condition_variable   cv_task       = {};
+    std::condition_variable   cv_done       = {};
+    const task_t*             task          = {};
+    size_t                    tasks_count   = {};
+    std::atomic<size_t>       task_next     = {};
+    size_t                    pending       = {};
+    uint64_t                  generation    = {};
+    bool                      stop          = {};
+
+    thread_pool_t(size_t threads_count);
+    ~thread_pool_t();
+    void run(size_t count, const task_t& task);
+    void work();
+
+    size_t size() const {
+      return threads.size() + 1;
+    }
+  };
+
   struct world_t {
-    using cells_t = std::vector<cell_t>;
+    using cells_t = cells_soa_t;
+    using pool_t  = std::unique_ptr<thread_pool_t>;
 
     std::string    config_file_name   = {};
     std::string    world_file_name    = {};
@@ -255,19 +865,74 @@ namespace genesis_n {
     cells_t        cells              = {};
     stats_t        stats              = {};
 
-    size_t         time_ms            = {};
-    size_t         update_world_ms    = {};
-    size_t         save_world_ms      = {};
+    scheduler_t    scheduler          = {};
+    std::function<void(world_t&)>   stats_hook   = {}; // every interval_stats_ms, when set
+
+    pool_t         pool               = {};
+    uint64_t       seed               = {};
+
+    // the cells the world updates, [beg, end); a shard of a larger world leaves the halo
+    // around them, the copies of its neighbours' cells, to their owners
+    xy_pos_t       owned_beg          = {};
+    xy_pos_t       owned_end          = {utils_t::npos, utils_t::npos};
+    // where the cells lie in that larger world, which keys the draws of a cell by its place
+    // there, so the shards draw what a single world would
+    xy_pos_t       global_beg         = {};
+    size_t         global_x_max       = {}; // 0 when the world is not a shard
+
+    std::vector<uint32_t>   live_order   = {}; // live cells at the start of the tick, row-major
+    std::vector<uint32_t>   live_tiles   = {}; // live_order grouped by tile
+    std::vector<size_t>     tiles_beg    = {}; // live_tiles range of every tile
+    std::vector<uint16_t>   emission_row = {}; // update_emission_expected rounding offsets of a row
+
+    std::thread             save_thread  = {}; // writer of the last save_data_async
+    std::atomic<bool>       save_busy    = {}; // the writer has not finished yet
+    std::atomic<bool>       save_failed  = {}; // set by the writer, taken by save_commit
+    std::atomic<uint64_t>   save_write   = {}; // us, set by the writer when it is done
+
+    bool       checkpoint_base       = {}; // a full save the deltas apply to is on disk
+    uint64_t   checkpoint_base_age   = {}; // stats.age of that save
+    uint64_t   checkpoint_sequence   = {}; // deltas written after it
+    bool       checkpoint_pending    = {}; // a write was started and not committed yet
+    uint64_t   checkpoint_next_age   = {}; // the chain it makes once written
+    uint64_t   checkpoint_next_seq   = {};
+
+    profiler_t     profiler           = {};
+    replay_log_t   replay             = {};
+    std::ofstream  hash_log           = {}; // every hash_log_ticks, age and hash_tiles
+
+    ~world_t();
 
     void update();
     void update_world();
-    void update_mind(microbe_t& microbe);
-    bool update_mind_recipe(const recipe_t& recipe, microbe_t& microbe);
+    void update_emission();
+    void update_emission_expected(area_t& area, res_val_t* resources, res_val_t stack_size, const rand_t& rand);
+    void update_world_tiles();
+    void update_cell(size_t ind, stats_t& stats_tile);
+    void update_mind(microbe_ref_t& microbe, rand_t& rand, stats_t& stats_tile);
+    void update_mind_threaded(microbe_ref_t& microbe, rand_t& rand, stats_t& stats_tile);
+    void mind_move(microbe_ref_t& microbe);
+    void mind_clone(microbe_ref_t& microbe, uint8_t dir, rand_t& rand);
+    void mind_recipe(microbe_ref_t& microbe, uint8_t ind);
+    void mind_attack(microbe_ref_t& microbe, uint8_t dir, uint16_t strength);
+    void mind_exchange(microbe_ref_t& microbe, uint8_t dir, uint8_t res, res_val_t val);
+    bool update_mind_recipe(const recipe_t& recipe, auto& microbe);
     void init();
+    void init_scheduler();
     void load_config();
     void save_config();
     void load_data();
+    void load_resized(const snapshot_header_t& header);
     void save_data();
+    bool save_data_async();
+    bool save_delta_async();
+    void save_start(std::function<bool()> write);
+    void save_wait();
+    void save_commit();
+    bool save_trace();
+    uint64_t hash();
+    uint64_t hash_tiles(bool full = false);
+    void fill_random(double occupancy, int regs_fill = -1, res_val_t energy = 0, size_t radius = 0);
 
     size_t xy_pos_to_ind(const xy_pos_t& pos) {
       TRACE_GENESIS;
@@ -279,6 +944,25 @@ namespace genesis_n {
       return {ind % config.x_max, ind / config.x_max};
     }
 
+    bool owned(size_t ind) const {
+      TRACE_GENESIS;
+      return owned(xy_pos_t{ind % config.x_max, ind / config.x_max});
+    }
+
+    bool owned(const xy_pos_t& pos) const {
+      TRACE_GENESIS;
+      return pos.first >= owned_beg.first && pos.first < owned_end.first
+          && pos.second >= owned_beg.second && pos.second < owned_end.second;
+    }
+
+    size_t global_ind(size_t ind) const {
+      TRACE_GENESIS;
+      if (!global_x_max) {
+        return ind;
+      }
+      return (ind % config.x_max + global_beg.first) + (ind / config.x_max + global_beg.second) * global_x_max;
+    }
+
     bool pos_valid(const xy_pos_t& pos) const {
       TRACE_GENESIS;
       return pos.first < config.x_max && pos.second < config.y_max;
@@ -321,6 +1005,8 @@ namespace genesis_n {
     JSON_SAVE2(json, area_json, frequency);
     JSON_SAVE2(json, area_json, factor);
     JSON_SAVE2(json, area_json, sigma);
+    json["emission"] = utils_t::emissions.at(area_json.emission);
+    JSON_SAVE2(json, area_json, stochastic_rounding);
   }
 
   inline void from_json(const nlohmann::json& json, area_t& area_json) {
@@ -330,6 +1016,12 @@ namespace genesis_n {
     JSON_LOAD2(json, area_json, frequency);
     JSON_LOAD2(json, area_json, factor);
     JSON_LOAD2(json, area_json, sigma);
+    JSON_LOAD2(json, area_json, stochastic_rounding);
+
+    // an unknown name is left as npos for the config validation
+    std::string emission = json.value("emission", utils_t::emissions[utils_t::EMISSION_RANDOM]);
+    auto it = std::find(utils_t::emissions.begin(), utils_t::emissions.end(), emission);
+    area_json.emission = it != utils_t::emissions.end() ? it - utils_t::emissions.begin() : utils_t::npos;
   }
 
   inline void to_json(nlohmann::json& json, const resource_info_t& resource_info_json) {
@@ -360,12 +1052,38 @@ namespace genesis_n {
     JSON_LOAD2(json, recipe_json, in_out);
   }
 
+  inline void to_json(nlohmann::json& json, const phase_stats_t& phase_stats) {
+    TRACE_GENESIS;
+    JSON_SAVE2(json, phase_stats, p50);
+    JSON_SAVE2(json, phase_stats, p99);
+    JSON_SAVE2(json, phase_stats, max);
+  }
+
+  inline void from_json(const nlohmann::json& json, phase_stats_t& phase_stats) {
+    TRACE_GENESIS;
+    JSON_LOAD2(json, phase_stats, p50);
+    JSON_LOAD2(json, phase_stats, p99);
+    JSON_LOAD2(json, phase_stats, max);
+  }
+
   inline void to_json(nlohmann::json& json, const stats_t& stats) {
     TRACE_GENESIS;
     JSON_SAVE2(json, stats, age);
     JSON_SAVE2(json, stats, microbes_count);
     JSON_SAVE2(json, stats, microbes_age_avg);
     JSON_SAVE2(json, stats, time_update);
+    JSON_SAVE2(json, stats, instructions);
+    JSON_SAVE2(json, stats, time_save_stall);
+    JSON_SAVE2(json, stats, time_save_write);
+    JSON_SAVE2(json, stats, time_emission);
+    JSON_SAVE2(json, stats, deaths);
+    JSON_SAVE2(json, stats, time_death);
+    for (size_t ind{}; ind < utils_t::OPCODES_COUNT; ++ind) {
+      json["opcodes"][utils_t::opcodes[ind]] = stats.opcodes[ind];
+    }
+    for (size_t ind{}; ind < utils_t::PHASES_COUNT; ++ind) {
+      json["phases"][utils_t::phases[ind]] = stats.phases[ind];
+    }
   }
 
   inline void from_json(const nlohmann::json& json, stats_t& stats) {
@@ -374,6 +1092,20 @@ namespace genesis_n {
     JSON_LOAD2(json, stats, microbes_count);
     JSON_LOAD2(json, stats, microbes_age_avg);
     JSON_LOAD2(json, stats, time_update);
+    JSON_LOAD2(json, stats, instructions);
+    JSON_LOAD2(json, stats, time_save_stall);
+    JSON_LOAD2(json, stats, time_save_write);
+    JSON_LOAD2(json, stats, time_emission);
+    JSON_LOAD2(json, stats, deaths);
+    JSON_LOAD2(json, stats, time_death);
+    auto opcodes = json.value("opcodes", nlohmann::json::object());
+    for (size_t ind{}; ind < utils_t::OPCODES_COUNT; ++ind) {
+      stats.opcodes[ind] = opcodes.value(utils_t::opcodes[ind], uint64_t{});
+    }
+    auto phases = json.value("phases", nlohmann::json::object());
+    for (size_t ind{}; ind < utils_t::PHASES_COUNT; ++ind) {
+      stats.phases[ind] = phases.value(utils_t::phases[ind], phase_stats_t{});
+    }
   }
 
   inline void to_json(nlohmann::json& json, const microbe_t& microbe) {
@@ -382,6 +1114,9 @@ namespace genesis_n {
     JSON_SAVE2(json, microbe, code);
     JSON_SAVE2(json, microbe, regs);
     JSON_SAVE2(json, microbe, family);
+    if (microbe.alive) {
+      JSON_SAVE2(json, microbe, genome);
+    }
     JSON_SAVE2(json, microbe, resources);
     JSON_SAVE2(json, microbe, pos);
     JSON_SAVE2(json, microbe, age);
@@ -395,6 +1130,7 @@ namespace genesis_n {
     JSON_LOAD2(json, microbe, code);
     JSON_LOAD2(json, microbe, regs);
     JSON_LOAD2(json, microbe, family);
+    JSON_LOAD2(json, microbe, genome);
     JSON_LOAD2(json, microbe, resources);
     JSON_LOAD2(json, microbe, pos);
     JSON_LOAD2(json, microbe, age);
@@ -416,7 +1152,27 @@ namespace genesis_n {
 
   ////////////////////////////////////////////////////////////////////////////////
 
-  void utils_t::rename(const std::string& name_old, const std::string& name_new) {
+  // Category names match without their padding, so "mind" enables MIND as "mind " does.
+  void utils_t::set_debug(const std::set<std::string>& debug) {
+    TRACE_GENESIS;
+
+    auto trim = [](std::string name) {
+      name.erase(name.find_last_not_of(' ') + 1);
+      return name;
+    };
+
+    utils_t::debug = debug;
+    debug_mask = {};
+    for (const auto& name : debug) {
+      for (uint32_t category{}; category < categories.size(); ++category) {
+        if (trim(name) == trim(categories[category])) {
+          debug_mask |= 1ULL << category;
+        }
+      }
+    }
+  }
+
+  bool utils_t::rename(const std::string& name_old, const std::string& name_new) {
     TRACE_GENESIS;
     LOG_GENESIS(ARGS, "name_old: %s", name_old.c_str());
     LOG_GENESIS(ARGS, "name_new: %s", name_new.c_str());
@@ -425,7 +1181,9 @@ namespace genesis_n {
     std::filesystem::rename(name_old, name_new, ec);
     if (ec) {
       LOG_GENESIS(ERROR, "%s", ec.message().c_str());
+      return false;
     }
+    return true;
   }
 
   void utils_t::remove(const std::string& name) {
@@ -449,10 +1207,8 @@ namespace genesis_n {
     }
 
     try {
-      std::ifstream file(name);
-      std::istream_iterator<uint8_t> begin(file);
-      std::istream_iterator<uint8_t> end;
-      std::string data(begin, end);
+      std::ifstream file(name, std::ios::binary);
+      std::string data(std::istreambuf_iterator<char>(file), {});
       if (binary) {
         json = nlohmann::json::from_msgpack(data);
       } else {
@@ -479,31 +1235,48 @@ namespace genesis_n {
     TRACE_GENESIS;
     LOG_GENESIS(ARGS, "name: %s", name.c_str());
 
-    std::string name_tmp = name + TMP_SUFFIX;
     try {
-      std::ofstream file(name_tmp);
-      std::ostream_iterator<uint8_t> it_out(file);
       if (binary) {
         auto data = nlohmann::json::to_msgpack(json);
-        std::copy(data.begin(), data.end(), it_out);
+        return save_file(name, data);
       } else {
         auto data = json.dump(2);
-        std::copy(data.begin(), data.end(), it_out);
+        return save_file(name, {reinterpret_cast<const uint8_t*>(data.data()), data.size()});
       }
-
-      utils_t::rename(name_tmp, name);
-      utils_t::remove(name_tmp);
-      return true;
     } catch (const std::exception& e) {
       LOG_GENESIS(ERROR, "%s", e.what());
       return false;
     }
   }
 
-  uint64_t utils_t::rand_u64() {
-    static std::mt19937 gen(seed);
-    static std::uniform_int_distribution<uint64_t> dis;
-    return dis(gen);
+  bool utils_t::save_file(const std::string& name, std::span<const uint8_t> data) {
+    TRACE_GENESIS;
+    LOG_GENESIS(ARGS, "name: %s", name.c_str());
+
+    // the file is replaced only once its data is on disk
+    std::string name_tmp = name + TMP_SUFFIX;
+    int fd = ::open(name_tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+      LOG_GENESIS(ERROR, "can not open file %s", name_tmp.c_str());
+      return false;
+    }
+
+    for (size_t pos{}; pos < data.size(); ) {
+      auto count = ::write(fd, data.data() + pos, data.size() - pos);
+      if (count <= 0) {
+        LOG_GENESIS(ERROR, "can not write file %s", name_tmp.c_str());
+        ::close(fd);
+        return false;
+      }
+      pos += count;
+    }
+
+    if (::fsync(fd) != 0 || ::close(fd) != 0) {
+      LOG_GENESIS(ERROR, "can not sync file %s", name_tmp.c_str());
+      return false;
+    }
+
+    return rename(name_tmp, name);
   }
 
   uint64_t utils_t::hash_mix(uint64_t h) {
@@ -564,6 +1337,12 @@ namespace genesis_n {
       return false;
     }
 
+    return load(json);
+  }
+
+  bool config_json_wrapper_t::load(const nlohmann::json& json) {
+    TRACE_GENESIS;
+
     std::map<std::string, size_t>   resources_names;
     std::map<std::string, size_t>   recipes_names;
     std::vector<recipe_json_t>      recipes;
@@ -611,6 +1390,37 @@ namespace genesis_n {
     config.interval_save_world_ms = 10 * 60 * 1000;
     JSON_LOAD2(json, config, interval_save_world_ms);
 
+    config.interval_checkpoint_ms = 0;
+    JSON_LOAD2(json, config, interval_checkpoint_ms);
+
+    config.interval_stats_ms = 0;
+    JSON_LOAD2(json, config, interval_stats_ms);
+
+    config.ticks_per_s = config.interval_update_world_ms ? 1000 / config.interval_update_world_ms : 1000;
+    JSON_LOAD2(json, config, ticks_per_s);
+
+    config.replay_keyframe_ticks = 0;
+    JSON_LOAD2(json, config, replay_keyframe_ticks);
+
+    config.replay_keyframes = 16;
+    JSON_LOAD2(json, config, replay_keyframes);
+
+    config.hash_log_ticks = 0;
+    JSON_LOAD2(json, config, hash_log_ticks);
+
+    std::string schedule = utils_t::schedules[config.interval_update_world_ms ? utils_t::SCHEDULE_RATE : utils_t::SCHEDULE_FAST];
+    JSON_LOAD(json, schedule);
+    auto schedule_it = std::find(utils_t::schedules.begin(), utils_t::schedules.end(), schedule);
+    if (schedule_it == utils_t::schedules.end()) {
+      LOG_GENESIS(ERROR, "invalid schedule %s", schedule.c_str());
+      return false;
+    }
+    config.schedule = schedule_it - utils_t::schedules.begin();
+    if (config.schedule != utils_t::SCHEDULE_FAST && (!config.ticks_per_s || config.ticks_per_s > 1000000000)) {
+      LOG_GENESIS(ERROR, "invalid ticks_per_s %zd", config.ticks_per_s);
+      return false;
+    }
+
     config.mutation_probability = 0.1;
     JSON_LOAD2(json, config, mutation_probability);
     if (config.mutation_probability < 0) {
@@ -626,6 +1436,19 @@ namespace genesis_n {
 
     config.resources = {}; // TODO
     JSON_LOAD2(json, config, resources);
+    for (auto& resource : config.resources) {
+      for (auto& area : resource.areas) {
+        if (area.radius > 4096) {
+          LOG_GENESIS(ERROR, "invalid area radius %zd", area.radius);
+          return false;
+        }
+        if (area.emission >= utils_t::emissions.size()) {
+          LOG_GENESIS(ERROR, "invalid area emission");
+          return false;
+        }
+        area.init_kernel();
+      }
+    }
 
     config.spawn_pos = {100, 100};
     JSON_LOAD2(json, config, spawn_pos);
@@ -642,6 +1465,20 @@ namespace genesis_n {
     config.binary_data = true;
     JSON_LOAD2(json, config, binary_data);
 
+    config.update_threads = 0;
+    JSON_LOAD2(json, config, update_threads);
+    if (config.update_threads > 1024) {
+      LOG_GENESIS(ERROR, "invalid update_threads %zd", config.update_threads);
+      return false;
+    }
+
+    config.update_tile_size = 32;
+    JSON_LOAD2(json, config, update_tile_size);
+    if (config.update_tile_size < 2) {
+      LOG_GENESIS(ERROR, "invalid update_tile_size %zd", config.update_tile_size);
+      return false;
+    }
+
     for (size_t i{}; i < config.resources.size(); ++i) {
       resources_names[config.resources[i].name] = i;
     }
@@ -694,6 +1531,24 @@ namespace genesis_n {
     }
     config.recipe_clone = recipes_names[recipe_clone];
 
+    std::string mind_backend = utils_t::mind_backends[utils_t::MIND_SWITCH];
+    JSON_LOAD(json, mind_backend);
+    auto it = std::find(utils_t::mind_backends.begin(), utils_t::mind_backends.end(), mind_backend);
+    if (it == utils_t::mind_backends.end()) {
+      LOG_GENESIS(ERROR, "invalid mind_backend %s", mind_backend.c_str());
+      return false;
+    }
+    config.mind_backend = it - utils_t::mind_backends.begin();
+
+    std::string world_format = utils_t::world_formats[utils_t::WORLD_SNAPSHOT];
+    JSON_LOAD(json, world_format);
+    it = std::find(utils_t::world_formats.begin(), utils_t::world_formats.end(), world_format);
+    if (it == utils_t::world_formats.end()) {
+      LOG_GENESIS(ERROR, "invalid world_format %s", world_format.c_str());
+      return false;
+    }
+    config.world_format = it - utils_t::world_formats.begin();
+
     return true;
   }
 
@@ -701,6 +1556,18 @@ namespace genesis_n {
     TRACE_GENESIS;
 
     nlohmann::json json = {};
+    save(json);
+
+    if (!utils_t::save(json, file_name)) {
+      LOG_GENESIS(ERROR, "can not save file %s", file_name.c_str());
+      return false;
+    }
+
+    return true;
+  }
+
+  void config_json_wrapper_t::save(nlohmann::json& json) {
+    TRACE_GENESIS;
 
     JSON_SAVE2(json, config, x_max);
     JSON_SAVE2(json, config, y_max);
@@ -711,6 +1578,12 @@ namespace genesis_n {
     JSON_SAVE2(json, config, energy_remaining);
     JSON_SAVE2(json, config, interval_update_world_ms);
     JSON_SAVE2(json, config, interval_save_world_ms);
+    JSON_SAVE2(json, config, interval_checkpoint_ms);
+    JSON_SAVE2(json, config, interval_stats_ms);
+    JSON_SAVE2(json, config, ticks_per_s);
+    JSON_SAVE2(json, config, replay_keyframe_ticks);
+    JSON_SAVE2(json, config, replay_keyframes);
+    JSON_SAVE2(json, config, hash_log_ticks);
     JSON_SAVE2(json, config, mutation_probability);
     JSON_SAVE2(json, config, seed);
     JSON_SAVE2(json, config, debug);
@@ -720,6 +1593,8 @@ namespace genesis_n {
     JSON_SAVE2(json, config, spawn_min_count);
     JSON_SAVE2(json, config, spawn_max_count);
     JSON_SAVE2(json, config, binary_data);
+    JSON_SAVE2(json, config, update_threads);
+    JSON_SAVE2(json, config, update_tile_size);
 
     std::vector<recipe_json_t> recipes = {};
     for (const auto& recipe_tmp : config.recipes) {
@@ -742,12 +1617,23 @@ namespace genesis_n {
     auto recipe_clone = config.recipes.at(config.recipe_clone).name;
     JSON_SAVE(json, recipe_clone);
 
-    if (!utils_t::save(json, file_name)) {
-      LOG_GENESIS(ERROR, "can not save file %s", file_name.c_str());
-      return false;
-    }
+    auto mind_backend = utils_t::mind_backends.at(config.mind_backend);
+    JSON_SAVE(json, mind_backend);
 
-    return true;
+    auto world_format = utils_t::world_formats.at(config.world_format);
+    JSON_SAVE(json, world_format);
+
+    auto schedule = utils_t::schedules.at(config.schedule);
+    JSON_SAVE(json, schedule);
+  }
+
+  uint64_t config_json_wrapper_t::hash() {
+    TRACE_GENESIS;
+
+    nlohmann::json json = {};
+    save(json);
+    auto data = json.dump();
+    return utils_t::fasthash64(data.data(), data.size(), 0);
   }
 
   ////////////////////////////////////////////////////////////////////////////////
@@ -761,35 +1647,83 @@ namespace genesis_n {
       json = nlohmann::json::object();
     }
 
-    JSON_LOAD2(json, world, cells);
+    JSON_LOAD2(json, world, stats);
+
+    std::vector<microbe_t::data_t> genomes;
+    JSON_LOAD(json, genomes);
 
-    world.cells.resize(world.config.x_max * world.config.y_max);
-    for (auto& cell : world.cells) {
+    std::vector<cell_t> cells;
+    JSON_LOAD(json, cells);
+
+    cells.resize(world.config.x_max * world.config.y_max);
+    world.cells.init(world.config);
+    for (size_t xy_ind{}; xy_ind < cells.size(); ++xy_ind) {
+      auto& cell = cells[xy_ind];
       cell.resources.resize(world.config.resources.size());
       for (size_t ind{}; ind < cell.resources.size(); ++ind) {
         auto& resource = cell.resources[ind];
         auto stack_size = world.config.resources[ind].stack_size;
         utils_t::normalize(resource, 0, stack_size);
       }
-      if (!cell.microbe.validation(world.config)) {
+      if (cell.microbe.code.empty() && cell.microbe.genome < genomes.size()) {
+        cell.microbe.code = genomes[cell.microbe.genome];
+      }
+      rand_t rand(world.seed, world.stats.age, utils_t::RAND_LOAD + xy_ind);
+      if (!cell.microbe.validation(world.config, rand)) {
         cell.microbe = {};
       }
+      world.cells.load(xy_ind, cell);
     }
 
-    JSON_LOAD2(json, world, stats);
-
     return true;
   }
 
   bool world_json_wrapper_t::save(const std::string& file_name) {
     TRACE_GENESIS;
 
+    cells_t cells;
+    copy(cells);
+    return save(file_name, cells, world.stats, world.config.binary_data);
+  }
+
+  void world_json_wrapper_t::copy(cells_t& cells) {
+    TRACE_GENESIS;
+
+    cells.resize(world.cells.size());
+    for (size_t ind{}; ind < cells.size(); ++ind) {
+      world.cells.save(ind, cells[ind]);
+    }
+  }
+
+  bool world_json_wrapper_t::save(const std::string& file_name, cells_t& cells, const stats_t& stats, bool binary) {
+    TRACE_GENESIS;
+
     nlohmann::json json = {};
 
-    JSON_SAVE2(json, world, cells);
-    JSON_SAVE2(json, world, stats);
+    // every distinct genome is written once, microbes refer to it by index; keyed by family,
+    // the code tells apart the genomes of colliding families, as in genome_store_t
+    std::vector<microbe_t::data_t>            genomes;
+    std::unordered_multimap<uint64_t, size_t> genomes_ind;
+
+    for (auto& cell : cells) {
+      auto& microbe = cell.microbe;
+      if (microbe.alive) {
+        auto [beg, end] = genomes_ind.equal_range(microbe.family);
+        auto it = std::find_if(beg, end, [&](const auto& entry) { return genomes[entry.second] == microbe.code; });
+        if (it == end) {
+          it = genomes_ind.emplace(microbe.family, genomes.size());
+          genomes.push_back(std::move(microbe.code));
+        }
+        microbe.code.clear();
+        microbe.genome = it->second;
+      }
+    }
+
+    JSON_SAVE(json, genomes);
+    JSON_SAVE(json, cells);
+    JSON_SAVE(json, stats);
 
-    if (!utils_t::save(json, file_name, world.config.binary_data)) {
+    if (!utils_t::save(json, file_name, binary)) {
       LOG_GENESIS(ERROR, "can not save file %s", file_name.c_str());
       return false;
     }
@@ -799,32 +1733,660 @@ namespace genesis_n {
 
   ////////////////////////////////////////////////////////////////////////////////
 
-  void microbe_t::init(const config_t& config) {
+  bool world_snapshot_wrapper_t::is_snapshot(const std::string& file_name) {
     TRACE_GENESIS;
 
-    alive              = true;
-    family             = utils_t::rand_u64();
-    // code
-    // regs
-    resources.assign(config.resources.size(), 0);
-    pos                = {utils_t::rand_u64() % config.x_max, utils_t::rand_u64() % config.y_max};
-    age                = config.age_max + utils_t::rand_u64() % config.age_max_delta - 0.5 * config.age_max_delta;
-    direction          = utils_t::rand_u64() % utils_t::direction_max;
-    energy_remaining   = {};
+    char magic[sizeof(snapshot_header_t::MAGIC)] = {};
+    std::ifstream file(file_name, std::ios::binary);
+    file.read(magic, sizeof(magic));
+    return file && std::memcmp(magic, snapshot_header_t::MAGIC, sizeof(magic)) == 0;
   }
 
-  bool microbe_t::validation(const config_t& config) {
+  bool world_snapshot_wrapper_t::load_header(const std::string& file_name, snapshot_header_t& header) {
     TRACE_GENESIS;
 
-    if (!alive) {
-      return false;
-    }
+    std::ifstream file(file_name, std::ios::binary);
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    return file && std::memcmp(header.magic, snapshot_header_t::MAGIC, sizeof(header.magic)) == 0
+        && header.version == snapshot_header_t::VERSION && header.header_size == sizeof(header);
+  }
 
-    if (code.size() != config.code_size) {
-      code.reserve(config.code_size);
-      while (code.size() < config.code_size) {
-        code.push_back(utils_t::rand_u64() % 0xFF);
-      }
+  std::string world_snapshot_wrapper_t::delta_file_name(const std::string& file_name, uint64_t sequence) {
+    TRACE_GENESIS;
+
+    return file_name + ".delta." + std::to_string(sequence);
+  }
+
+  void world_snapshot_wrapper_t::remove_deltas(const std::string& file_name) {
+    TRACE_GENESIS;
+
+    for (uint64_t sequence = 1; std::filesystem::exists(delta_file_name(file_name, sequence)); ++sequence) {
+      utils_t::remove(delta_file_name(file_name, sequence));
+    }
+  }
+
+  bool world_snapshot_wrapper_t::map_file(const std::string& file_name, const reader_t& reader) {
+    TRACE_GENESIS;
+
+    int fd = ::open(file_name.c_str(), O_RDONLY);
+    if (fd < 0) {
+      LOG_GENESIS(ERROR, "can not open file %s", file_name.c_str());
+      return false;
+    }
+
+    struct stat st = {};
+    if (::fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(snapshot_header_t)) {
+      LOG_GENESIS(ERROR, "invalid file %s", file_name.c_str());
+      ::close(fd);
+      return false;
+    }
+
+    size_t size = st.st_size;
+    void*  map  = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED) {
+      LOG_GENESIS(ERROR, "can not map file %s", file_name.c_str());
+      return false;
+    }
+
+    bool result = reader({static_cast<const uint8_t*>(map), size});
+    ::munmap(map, size);
+    return result;
+  }
+
+  bool world_snapshot_wrapper_t::load(const std::string& file_name) {
+    TRACE_GENESIS;
+
+    return map_file(file_name, [this](std::span<const uint8_t> data) {
+      return load(data);
+    });
+  }
+
+  bool world_snapshot_wrapper_t::load(std::span<const uint8_t> data) {
+    TRACE_GENESIS;
+
+    auto&  config          = world.config;
+    auto&  cells           = world.cells;
+    size_t count           = config.x_max * config.y_max;
+    size_t resources_count = config.resources.size();
+
+    snapshot_header_t header;
+    std::memcpy(&header, data.data(), sizeof(header));
+
+    if (std::memcmp(header.magic, snapshot_header_t::MAGIC, sizeof(header.magic))
+        || header.version != snapshot_header_t::VERSION
+        || header.header_size != sizeof(header))
+    {
+      LOG_GENESIS(ERROR, "unsupported snapshot version %d", header.version);
+      return false;
+    }
+
+    if (header.x_max != config.x_max
+        || header.y_max != config.y_max
+        || header.resources_count != resources_count
+        || header.code_size != config.code_size
+        || header.regs_size != config.regs_size)
+    {
+      LOG_GENESIS(ERROR, "snapshot does not match config");
+      return false;
+    }
+
+    if (header.file_size != data.size()
+        || header.microbes_count > count
+        || header.genomes_count > header.microbes_count
+        || header.genome_size < sizeof(uint64_t) + config.code_size
+        || header.microbe_size < sizeof(snapshot_microbe_t) + resources_count * sizeof(res_val_t) + config.regs_size
+        || header.resources_offset + count * resources_count * sizeof(res_val_t) > data.size()
+        || header.genomes_offset + header.genomes_count * header.genome_size > data.size()
+        || header.microbes_offset + header.microbes_count * header.microbe_size > data.size())
+    {
+      LOG_GENESIS(ERROR, "truncated snapshot");
+      return false;
+    }
+
+    if (header.config_hash != config_json_wrapper_t(config).hash()) {
+      LOG_GENESIS(DEBUG, "snapshot was saved with another config");
+    }
+
+    world.stats.age              = header.stats_age;
+    world.stats.microbes_count   = header.stats_microbes_count;
+    world.stats.microbes_age_avg = header.stats_microbes_age_avg;
+    world.stats.instructions     = header.stats_instructions;
+
+    cells.init(config);
+    std::memcpy(cells.resources_cell.data(), data.data() + header.resources_offset,
+        cells.resources_cell.size() * sizeof(res_val_t));
+
+    auto genomes = load_genomes(data.data() + header.genomes_offset, header.genomes_count, header.genome_size);
+    for (size_t i{}; i < header.microbes_count; ++i) {
+      if (!load_microbe(data.data() + header.microbes_offset + i * header.microbe_size, genomes)) {
+        LOG_GENESIS(ERROR, "invalid snapshot microbe %zd", i);
+      }
+    }
+    for (auto genome : genomes) {
+      cells.genomes.release(genome);
+    }
+
+    return true;
+  }
+
+  bool world_snapshot_wrapper_t::save(const std::string& file_name) {
+    TRACE_GENESIS;
+
+    std::vector<uint8_t> data;
+    save(data);
+    return utils_t::save_file(file_name, data);
+  }
+
+  void world_snapshot_wrapper_t::save(std::vector<uint8_t>& data) {
+    TRACE_GENESIS;
+
+    auto&  config          = world.config;
+    auto&  cells           = world.cells;
+    size_t count           = cells.size();
+    size_t resources_count = cells.resources_count;
+
+    auto align = [](size_t size) {
+      return (size + 7) & ~size_t{7};
+    };
+
+    std::vector<uint32_t> live = cells.live;
+    std::sort(live.begin(), live.end());
+
+    genomes_t     genomes;
+    genomes_ind_t genomes_ind;
+    save_genomes(live, genomes, genomes_ind);
+
+    snapshot_header_t header;
+    std::memcpy(header.magic, snapshot_header_t::MAGIC, sizeof(header.magic));
+    header.version                = snapshot_header_t::VERSION;
+    header.header_size            = sizeof(header);
+    header.config_hash            = config_json_wrapper_t(config).hash();
+    header.x_max                  = config.x_max;
+    header.y_max                  = config.y_max;
+    header.resources_count        = resources_count;
+    header.code_size              = config.code_size;
+    header.regs_size              = config.regs_size;
+    header.genomes_count          = genomes.size();
+    header.genome_size            = align(sizeof(uint64_t) + config.code_size);
+    header.microbes_count         = live.size();
+    header.microbe_size           = align(sizeof(snapshot_microbe_t)
+        + resources_count * sizeof(res_val_t) + config.regs_size);
+    header.resources_offset       = align(sizeof(header));
+    header.genomes_offset         = header.resources_offset + align(count * resources_count * sizeof(res_val_t));
+    header.microbes_offset        = header.genomes_offset + header.genomes_count * header.genome_size;
+    header.file_size              = header.microbes_offset + header.microbes_count * header.microbe_size;
+    header.stats_age              = world.stats.age;
+    header.stats_microbes_count   = world.stats.microbes_count;
+    header.stats_microbes_age_avg = world.stats.microbes_age_avg;
+    header.stats_instructions     = world.stats.instructions;
+
+    data.assign(header.file_size, 0);
+    std::memcpy(data.data(), &header, sizeof(header));
+    std::memcpy(data.data() + header.resources_offset, cells.resources_cell.data(),
+        cells.resources_cell.size() * sizeof(res_val_t));
+
+    for (size_t i{}; i < genomes.size(); ++i) {
+      save_genome(data.data() + header.genomes_offset + i * header.genome_size, genomes[i]);
+    }
+    for (size_t i{}; i < live.size(); ++i) {
+      save_microbe(data.data() + header.microbes_offset + i * header.microbe_size, live[i],
+          genomes_ind[cells.genome[live[i]]]);
+    }
+  }
+
+  bool world_snapshot_wrapper_t::load_delta(const std::string& file_name, uint64_t base_age, uint64_t sequence) {
+    TRACE_GENESIS;
+
+    return map_file(file_name, [&](std::span<const uint8_t> data) {
+      return load_delta(data, base_age, sequence);
+    });
+  }
+
+  bool world_snapshot_wrapper_t::load_delta(std::span<const uint8_t> data, uint64_t base_age, uint64_t sequence) {
+    TRACE_GENESIS;
+
+    auto&  config          = world.config;
+    auto&  cells           = world.cells;
+    size_t count           = cells.size();
+    size_t resources_count = cells.resources_count;
+
+    delta_header_t header;
+    if (data.size() < sizeof(header)) {
+      LOG_GENESIS(ERROR, "truncated delta");
+      return false;
+    }
+    std::memcpy(&header, data.data(), sizeof(header));
+
+    if (std::memcmp(header.magic, delta_header_t::MAGIC, sizeof(header.magic))
+        || header.version != delta_header_t::VERSION
+        || header.header_size != sizeof(header))
+    {
+      LOG_GENESIS(ERROR, "unsupported delta version %d", header.version);
+      return false;
+    }
+
+    // a delta left over from an older chain is not an error, the chain just ends before it
+    if (header.base_age != base_age || header.sequence != sequence) {
+      LOG_GENESIS(DEBUG, "delta %zd does not continue the chain", sequence);
+      return false;
+    }
+
+    if (header.x_max != config.x_max
+        || header.y_max != config.y_max
+        || header.resources_count != resources_count
+        || header.code_size != config.code_size
+        || header.regs_size != config.regs_size
+        || header.tile_size == 0)
+    {
+      LOG_GENESIS(ERROR, "delta does not match config");
+      return false;
+    }
+
+    size_t tiles_x = (config.x_max + header.tile_size - 1) / header.tile_size;
+    size_t tiles_y = (config.y_max + header.tile_size - 1) / header.tile_size;
+
+    if (header.file_size != data.size()
+        || header.spans_count > tiles_x * tiles_y * header.tile_size
+        || header.microbes_count > count
+        || header.genomes_count > header.microbes_count
+        || header.genome_size < sizeof(uint64_t) + config.code_size
+        || header.microbe_size < sizeof(snapshot_microbe_t) + resources_count * sizeof(res_val_t) + config.regs_size
+        || header.spans_offset + header.spans_count * sizeof(uint32_t) > data.size()
+        || header.resources_offset > header.genomes_offset
+        || header.genomes_offset + header.genomes_count * header.genome_size > data.size()
+        || header.microbes_offset + header.microbes_count * header.microbe_size > data.size())
+    {
+      LOG_GENESIS(ERROR, "truncated delta");
+      return false;
+    }
+
+    // x_beg, x_end and the row of a span
+    auto span_row = [&](uint32_t span) {
+      size_t tile  = span / header.tile_size;
+      size_t x_beg = tile % tiles_x * header.tile_size;
+      return std::array<size_t, 3>{x_beg, std::min(x_beg + header.tile_size, config.x_max),
+          tile / tiles_x * header.tile_size + span % header.tile_size};
+    };
+
+    // everything is checked before the world is touched, a rejected delta leaves it as it was
+    std::vector<uint32_t> spans(header.spans_count);
+    std::memcpy(spans.data(), data.data() + header.spans_offset, spans.size() * sizeof(uint32_t));
+    size_t area = {};
+    for (auto span : spans) {
+      if (span >= tiles_x * tiles_y * header.tile_size || span_row(span)[2] >= config.y_max) {
+        LOG_GENESIS(ERROR, "invalid delta span %d", span);
+        return false;
+      }
+      auto [x_beg, x_end, y] = span_row(span);
+      area += x_end - x_beg;
+    }
+    if (header.resources_offset + area * resources_count * sizeof(res_val_t) > header.genomes_offset) {
+      LOG_GENESIS(ERROR, "truncated delta");
+      return false;
+    }
+
+    // the spans are emptied and their resources restored before the microbes come back
+    const uint8_t* resources = data.data() + header.resources_offset;
+    for (auto span : spans) {
+      auto [x_beg, x_end, y] = span_row(span);
+      size_t width = (x_end - x_beg) * sizeof(res_val_t);
+      for (size_t x = x_beg; x < x_end; ++x) {
+        if (cells.alive[x + y * config.x_max]) {
+          cells.kill(x + y * config.x_max);
+        }
+      }
+      for (size_t res{}; res < resources_count; ++res, resources += width) {
+        std::memcpy(&cells.resources_cell[res * count + x_beg + y * config.x_max], resources, width);
+      }
+    }
+
+    world.stats.age              = header.stats_age;
+    world.stats.microbes_count   = header.stats_microbes_count;
+    world.stats.microbes_age_avg = header.stats_microbes_age_avg;
+    world.stats.instructions     = header.stats_instructions;
+
+    auto genomes = load_genomes(data.data() + header.genomes_offset, header.genomes_count, header.genome_size);
+    for (size_t i{}; i < header.microbes_count; ++i) {
+      if (!load_microbe(data.data() + header.microbes_offset + i * header.microbe_size, genomes)) {
+        LOG_GENESIS(ERROR, "invalid delta microbe %zd", i);
+      }
+    }
+    for (auto genome : genomes) {
+      cells.genomes.release(genome);
+    }
+
+    return true;
+  }
+
+  void world_snapshot_wrapper_t::save_delta(std::vector<uint8_t>& data, uint64_t base_age, uint64_t sequence) {
+    TRACE_GENESIS;
+
+    auto&  config          = world.config;
+    auto&  cells           = world.cells;
+    size_t count           = cells.size();
+    size_t resources_count = cells.resources_count;
+
+    auto align = [](size_t size) {
+      return (size + 7) & ~size_t{7};
+    };
+
+    // x_beg, x_end and the row of a span
+    auto span_row = [&](uint32_t span) {
+      size_t tile  = span / cells.tile_size;
+      size_t x_beg = tile % cells.tiles_x * cells.tile_size;
+      return std::array<size_t, 3>{x_beg, std::min(x_beg + cells.tile_size, config.x_max),
+          tile / cells.tiles_x * cells.tile_size + span % cells.tile_size};
+    };
+
+    std::vector<uint32_t> spans;
+    std::vector<uint32_t> live;
+    size_t                area = {};
+    for (size_t tile{}; tile < cells.tiles_dirty.size(); ++tile) {
+      if (!(cells.tiles_dirty[tile] & cells_soa_t::DIRTY_CHECKPOINT)) {
+        continue;
+      }
+      for (size_t span = tile * cells.tile_size; span < (tile + 1) * cells.tile_size; ++span) {
+        auto [x_beg, x_end, y] = span_row(span);
+        if (!(cells.rows_dirty[span] & cells_soa_t::DIRTY_CHECKPOINT) || y >= config.y_max) {
+          continue;
+        }
+        spans.push_back(span);
+        area += x_end - x_beg;
+        for (size_t x = x_beg; x < x_end; ++x) {
+          if (cells.alive[x + y * config.x_max]) {
+            live.push_back(x + y * config.x_max);
+          }
+        }
+      }
+    }
+
+    genomes_t     genomes;
+    genomes_ind_t genomes_ind;
+    save_genomes(live, genomes, genomes_ind);
+
+    delta_header_t header;
+    std::memcpy(header.magic, delta_header_t::MAGIC, sizeof(header.magic));
+    header.version                = delta_header_t::VERSION;
+    header.header_size            = sizeof(header);
+    header.config_hash            = config_json_wrapper_t(config).hash();
+    header.x_max                  = config.x_max;
+    header.y_max                  = config.y_max;
+    header.resources_count        = resources_count;
+    header.code_size              = config.code_size;
+    header.regs_size              = config.regs_size;
+    header.tile_size              = cells.tile_size;
+    header.base_age               = base_age;
+    header.sequence               = sequence;
+    header.spans_count            = spans.size();
+    header.genomes_count          = genomes.size();
+    header.genome_size            = align(sizeof(uint64_t) + config.code_size);
+    header.microbes_count         = live.size();
+    header.microbe_size           = align(sizeof(snapshot_microbe_t)
+        + resources_count * sizeof(res_val_t) + config.regs_size);
+    header.spans_offset           = align(sizeof(header));
+    header.resources_offset       = header.spans_offset + align(spans.size() * sizeof(uint32_t));
+    header.genomes_offset         = header.resources_offset + align(area * resources_count * sizeof(res_val_t));
+    header.microbes_offset        = header.genomes_offset + header.genomes_count * header.genome_size;
+    header.file_size              = header.microbes_offset + header.microbes_count * header.microbe_size;
+    header.stats_age              = world.stats.age;
+    header.stats_microbes_count   = world.stats.microbes_count;
+    header.stats_microbes_age_avg = world.stats.microbes_age_avg;
+    header.stats_instructions     = world.stats.instructions;
+
+    data.assign(header.file_size, 0);
+    std::memcpy(data.data(), &header, sizeof(header));
+    std::memcpy(data.data() + header.spans_offset, spans.data(), spans.size() * sizeof(uint32_t));
+
+    uint8_t* resources = data.data() + header.resources_offset;
+    for (auto span : spans) {
+      auto [x_beg, x_end, y] = span_row(span);
+      size_t width = (x_end - x_beg) * sizeof(res_val_t);
+      for (size_t res{}; res < resources_count; ++res, resources += width) {
+        std::memcpy(resources, &cells.resources_cell[res * count + x_beg + y * config.x_max], width);
+      }
+    }
+
+    for (size_t i{}; i < genomes.size(); ++i) {
+      save_genome(data.data() + header.genomes_offset + i * header.genome_size, genomes[i]);
+    }
+    for (size_t i{}; i < live.size(); ++i) {
+      save_microbe(data.data() + header.microbes_offset + i * header.microbe_size, live[i],
+          genomes_ind[cells.genome[live[i]]]);
+    }
+  }
+
+  void world_snapshot_wrapper_t::save_genomes(const std::vector<uint32_t>& live, genomes_t& genomes,
+      genomes_ind_t& genomes_ind)
+  {
+    TRACE_GENESIS;
+
+    auto& cells = world.cells;
+    for (auto ind : live) {
+      if (genomes_ind.try_emplace(cells.genome[ind], genomes.size()).second) {
+        genomes.push_back(cells.genome[ind]);
+      }
+    }
+  }
+
+  void world_snapshot_wrapper_t::save_genome(uint8_t* record, const genome_t* genome) {
+    TRACE_GENESIS;
+
+    std::memcpy(record, &genome->family, sizeof(uint64_t));
+    std::memcpy(record + sizeof(uint64_t), genome->code.data(), world.config.code_size);
+  }
+
+  void world_snapshot_wrapper_t::save_microbe(uint8_t* record, size_t ind, uint32_t genome) {
+    TRACE_GENESIS;
+
+    auto&  cells           = world.cells;
+    size_t count           = cells.size();
+    size_t resources_count = cells.resources_count;
+
+    snapshot_microbe_t microbe = {
+      .ind              = static_cast<uint32_t>(ind),
+      .genome           = genome,
+      .age              = cells.age[ind],
+      .direction        = cells.direction[ind],
+      .energy_remaining = cells.energy_remaining[ind],
+    };
+    std::memcpy(record, &microbe, sizeof(microbe));
+
+    uint8_t* resources = record + sizeof(microbe);
+    for (size_t res{}; res < resources_count; ++res) {
+      std::memcpy(resources + res * sizeof(res_val_t), &cells.resources_microbe[res * count + ind],
+          sizeof(res_val_t));
+    }
+    std::memcpy(resources + resources_count * sizeof(res_val_t), cells.arena.regs(cells.slot[ind]).data(),
+        world.config.regs_size);
+  }
+
+  // The returned table holds a reference to every genome until the microbes took theirs,
+  // the caller releases them. The family of the file is checked against its code, the
+  // code wins.
+  world_snapshot_wrapper_t::genomes_t world_snapshot_wrapper_t::load_genomes(const uint8_t* records,
+      size_t count, size_t size)
+  {
+    TRACE_GENESIS;
+
+    genomes_t genomes(count);
+    for (size_t i{}; i < genomes.size(); ++i) {
+      const uint8_t* record = records + i * size;
+      uint64_t family;
+      std::memcpy(&family, record, sizeof(family));
+      std::span<const uint8_t> code = {record + sizeof(family), world.config.code_size};
+      if (family != utils_t::fasthash64(code.data(), code.size(), 0)) {
+        LOG_GENESIS(ERROR, "invalid snapshot genome %zd, its family is not the hash of its code", i);
+        family = utils_t::fasthash64(code.data(), code.size(), 0);
+      }
+      genomes[i] = world.cells.genomes.intern(family, code);
+    }
+    return genomes;
+  }
+
+  bool world_snapshot_wrapper_t::load_microbe(const uint8_t* record, const genomes_t& genomes) {
+    TRACE_GENESIS;
+
+    auto&  cells           = world.cells;
+    size_t count           = cells.size();
+    size_t resources_count = cells.resources_count;
+
+    snapshot_microbe_t microbe;
+    std::memcpy(&microbe, record, sizeof(microbe));
+    if (microbe.ind >= count || microbe.genome >= genomes.size() || cells.alive[microbe.ind]) {
+      return false;
+    }
+
+    size_t ind = microbe.ind;
+    cells.alloc(ind);
+    cells.set_genome(ind, cells.genomes.acquire(genomes[microbe.genome]));
+    cells.age[ind]              = microbe.age;
+    cells.direction[ind]        = microbe.direction % utils_t::direction_max;
+    cells.energy_remaining[ind] = microbe.energy_remaining;
+
+    const uint8_t* resources = record + sizeof(microbe);
+    for (size_t res{}; res < resources_count; ++res) {
+      std::memcpy(&cells.resources_microbe[res * count + ind], resources + res * sizeof(res_val_t),
+          sizeof(res_val_t));
+    }
+    std::memcpy(cells.arena.regs(cells.slot[ind]).data(), resources + resources_count * sizeof(res_val_t),
+        world.config.regs_size);
+
+    return true;
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////
+
+  void area_t::init_kernel() {
+    TRACE_GENESIS;
+
+    // The tick adds the delta to an integer resource and clamps it to [0, stack_size],
+    // so its floor is all that matters; it is bounded to keep it in an int32_t.
+    kernel.assign((radius + 1) * (radius + 1), 0);
+    for (size_t dy{}; radius && dy <= radius; ++dy) {
+      for (size_t dx{}; dx <= radius; ++dx) {
+        size_t dist = utils_t::distance({0, 0}, {dx, dy});
+        double resource_delta = factor * std::max(0.,
+            1. - std::pow(std::abs(1. * dist / radius), sigma));
+        kernel[dx + dy * (radius + 1)] = std::clamp(std::floor(resource_delta), -65536., 65536.);
+      }
+    }
+
+    // The random emission spreads its draws evenly over the (2 * radius)^2 offsets, so the
+    // expected delta of an offset per tick is the kernel times the draws per offset.
+    expected.clear();
+    if (emission == utils_t::EMISSION_EXPECTED && radius) {
+      size_t side  = 2 * radius;
+      double rate  = size_t(frequency * 3.14 * radius * radius) / (1. * side * side);
+      expected.assign(side * side, 0);
+      for (size_t y{}; y < side; ++y) {
+        for (size_t x{}; x < side; ++x) {
+          size_t dx = x < radius ? radius - x : x - radius;
+          size_t dy = y < radius ? radius - y : y - radius;
+          double value = std::clamp(rate * kernel[dx + dy * (radius + 1)], -32767., 32767.);
+          expected[x + y * side] = std::lround(value * 65536);
+        }
+      }
+    }
+  }
+
+  void emission_batch_t::resolve(const area_t& area, size_t x_max, size_t y_max) {
+    TRACE_GENESIS;
+
+    if (avx2) {
+      resolve_avx2(area, x_max, y_max);
+    } else {
+      resolve_scalar(area, x_max, y_max, 0);
+    }
+  }
+
+  void emission_batch_t::resolve_scalar(const area_t& area, size_t x_max, size_t y_max, size_t beg) {
+    TRACE_GENESIS;
+
+    int64_t radius = area.radius;
+    for (size_t i = beg; i < count; ++i) {
+      int64_t dx = offset_x[i] - radius;
+      int64_t dy = offset_y[i] - radius;
+      int64_t x  = area.pos.first  + dx;
+      int64_t y  = area.pos.second + dy;
+      delta[i] = area.kernel[std::abs(dx) + std::abs(dy) * (radius + 1)];
+      ind[i]   = x >= 0 && x < int64_t(x_max) && y >= 0 && y < int64_t(y_max) ? x + y * x_max : npos;
+    }
+  }
+
+#ifdef __x86_64__
+  // Eight draws at a time; the caller keeps the area and the world within int32_t.
+  __attribute__((target("avx2")))
+  void emission_batch_t::resolve_avx2(const area_t& area, size_t x_max, size_t y_max) {
+    TRACE_GENESIS;
+
+    const __m256i radius = _mm256_set1_epi32(area.radius);
+    const __m256i width  = _mm256_set1_epi32(area.radius + 1);
+    const __m256i pos_x  = _mm256_set1_epi32(area.pos.first);
+    const __m256i pos_y  = _mm256_set1_epi32(area.pos.second);
+    const __m256i size_x = _mm256_set1_epi32(x_max);
+    const __m256i sign   = _mm256_set1_epi32(std::numeric_limits<int32_t>::min());
+    const __m256i max_x  = _mm256_xor_si256(size_x, sign);
+    const __m256i max_y  = _mm256_xor_si256(_mm256_set1_epi32(y_max), sign);
+    const __m256i none   = _mm256_set1_epi32(npos);
+
+    size_t i{};
+    for (; i + 8 <= count; i += 8) {
+      __m256i dx = _mm256_sub_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(&offset_x[i])), radius);
+      __m256i dy = _mm256_sub_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(&offset_y[i])), radius);
+      __m256i k  = _mm256_add_epi32(_mm256_abs_epi32(dx), _mm256_mullo_epi32(_mm256_abs_epi32(dy), width));
+      __m256i x  = _mm256_add_epi32(pos_x, dx);
+      __m256i y  = _mm256_add_epi32(pos_y, dy);
+
+      // unsigned x < x_max and y < y_max, negative coordinates wrap to large ones
+      __m256i valid = _mm256_and_si256(
+          _mm256_cmpgt_epi32(max_x, _mm256_xor_si256(x, sign)),
+          _mm256_cmpgt_epi32(max_y, _mm256_xor_si256(y, sign)));
+      __m256i xy = _mm256_add_epi32(x, _mm256_mullo_epi32(y, size_x));
+
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(&delta[i]),
+          _mm256_i32gather_epi32(area.kernel.data(), k, sizeof(int32_t)));
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(&ind[i]), _mm256_blendv_epi8(none, xy, valid));
+    }
+
+    resolve_scalar(area, x_max, y_max, i);
+  }
+#else
+  void emission_batch_t::resolve_avx2(const area_t& area, size_t x_max, size_t y_max) {
+    TRACE_GENESIS;
+
+    resolve_scalar(area, x_max, y_max, 0);
+  }
+#endif
+
+  ////////////////////////////////////////////////////////////////////////////////
+
+  void microbe_t::init(const config_t& config, rand_t& rand) {
+    TRACE_GENESIS;
+
+    alive              = true;
+    family             = rand();
+    // code
+    // regs
+    resources.assign(config.resources.size(), 0);
+    pos                = {rand() % config.x_max, rand() % config.y_max};
+    age                = config.age_max + rand() % config.age_max_delta - 0.5 * config.age_max_delta;
+    direction          = rand() % utils_t::direction_max;
+    energy_remaining   = {};
+  }
+
+  bool microbe_t::validation(const config_t& config, rand_t& rand) {
+    TRACE_GENESIS;
+
+    if (!alive) {
+      return false;
+    }
+
+    if (code.size() != config.code_size) {
+      code.reserve(config.code_size);
+      while (code.size() < config.code_size) {
+        code.push_back(rand() % 0xFF);
+      }
       code.resize(config.code_size);
     }
 
@@ -833,7 +2395,7 @@ namespace genesis_n {
     if (regs.size() != config.regs_size) {
       regs.reserve(config.regs_size);
       while (regs.size() < config.regs_size) {
-        regs.push_back(utils_t::rand_u64() % 0xFF);
+        regs.push_back(rand() % 0xFF);
       }
       regs.resize(config.regs_size);
     }
@@ -855,136 +2417,956 @@ namespace genesis_n {
     return true;
   }
 
-  ////////////////////////////////////////////////////////////////////////////////
-
-  void world_t::update() {
+  void microbe_ref_t::init(const config_t& config, rand_t& rand) {
     TRACE_GENESIS;
 
-    auto time_prev_ms = time_ms;
-    time_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
-        std::chrono::system_clock::now().time_since_epoch()).count();
+    alive              = true;
+    family             = rand();
+    for (size_t ind{}; ind < resources.size(); ++ind) {
+      resources[ind] = 0;
+    }
+    pos                = {rand() % config.x_max, rand() % config.y_max};
+    age                = config.age_max + rand() % config.age_max_delta - 0.5 * config.age_max_delta;
+    direction          = rand() % utils_t::direction_max;
+    energy_remaining   = {};
+  }
 
-    stats.time_update = time_ms - time_prev_ms;
+  bool microbe_ref_t::validation(const config_t& config) {
+    TRACE_GENESIS;
 
-    LOG_GENESIS(TIME, "time %zd", time_ms);
+    if (!alive) {
+      return false;
+    }
 
-    if (update_world_ms < time_ms) {
-      LOG_GENESIS(TIME, "update_world_ms %zd   %zd", time_ms, time_ms - update_world_ms);
-      update_world_ms = time_ms + config.interval_update_world_ms;
-      update_world();
+    for (size_t ind{}; ind < resources.size(); ++ind) {
+      utils_t::normalize(resources[ind], 0, config.resources[ind].stack_size);
     }
 
-    if (save_world_ms < time_ms) {
-      LOG_GENESIS(TIME, "save_world_ms %zd   %zd", time_ms, time_ms - save_world_ms);
-      save_world_ms = time_ms + config.interval_save_world_ms;
-      save_data();
+    if (pos.first >= config.x_max || pos.second >= config.y_max) {
+      LOG_GENESIS(ERROR, "invalid microbe_ref_t::pos %zd %zd", pos.first, pos.second);
+      return false;
     }
 
-    LOG_GENESIS(TIME, "time end %zd", time_ms);
+    utils_t::normalize(age, 0L, static_cast<int64_t>(config.age_max + config.age_max_delta));
+
+    direction %= utils_t::direction_max;
+
+    return true;
   }
 
-  void world_t::update_world() {
+  ////////////////////////////////////////////////////////////////////////////////
+
+  void regs_arena_t::init(size_t slots_max, size_t regs_size) {
     TRACE_GENESIS;
 
-    stats.microbes_count = {};
-    stats.microbes_age_avg = {};
+    this->regs_size = regs_size;
+    chunks.clear();
+    free.clear();
+    // chunks must not be reallocated while other workers read their slots
+    chunks.reserve((slots_max + chunk_slots - 1) / chunk_slots);
+  }
+
+  uint32_t regs_arena_t::alloc() {
+    TRACE_GENESIS;
+
+    std::lock_guard lock(mutex);
+    if (free.empty()) {
+      uint32_t first = chunks.size() * chunk_slots;
+      chunks.emplace_back(chunk_slots * regs_size, 0);
+      for (size_t i = chunk_slots; i > 0; --i) {
+        free.push_back(first + i - 1);
+      }
+    }
+
+    uint32_t slot = free.back();
+    free.pop_back();
+    return slot;
+  }
+
+  void regs_arena_t::release(uint32_t slot) {
+    TRACE_GENESIS;
+
+    std::lock_guard lock(mutex);
+    free.push_back(slot);
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////
+
+  void genome_store_t::init(size_t code_size, size_t regs_size) {
+    TRACE_GENESIS;
+
+    this->code_size = code_size;
+    this->regs_size = regs_size;
+    genomes.clear();
+
+    // rip is an uint8_t: the regs index of the opcode repeats every regs_size and the code
+    // bytes after it every code_size when they divide 0x100, both powers of two then
+    auto period = [](size_t size) { return 0x100 % size ? 0x100 : size; };
+    ops_size = std::max(period(code_size), period(regs_size));
+  }
 
+  const genome_t* genome_store_t::intern(std::span<const uint8_t> code) {
+    TRACE_GENESIS;
+
+    return intern(utils_t::fasthash64(code.data(), code.size(), 0), code);
+  }
+
+  const genome_t* genome_store_t::intern(uint64_t family, std::span<const uint8_t> code) {
+    TRACE_GENESIS;
+
+    std::lock_guard lock(mutex);
+    auto [beg, end] = genomes.equal_range(family);
+    auto it = std::find_if(beg, end, [&](const auto& entry) {
+      return std::equal(code.begin(), code.end(), entry.second.code.begin(), entry.second.code.end());
+    });
+    if (it == end) {
+      it = genomes.emplace(std::piecewise_construct, std::forward_as_tuple(family), std::forward_as_tuple());
+      auto& genome = it->second;
+      genome.family = family;
+      genome.code.assign(code.begin(), code.end());
+    }
+    it->second.refs++;
+    return &it->second;
+  }
+
+  const genome_t* genome_store_t::acquire(const genome_t* genome) {
+    TRACE_GENESIS;
+
+    std::lock_guard lock(mutex);
+    genome->refs++;
+    return genome;
+  }
+
+  void genome_store_t::release(const genome_t* genome) {
+    TRACE_GENESIS;
+
+    std::lock_guard lock(mutex);
+    if (--genome->refs == 0) {
+      auto [beg, end] = genomes.equal_range(genome->family);
+      genomes.erase(std::find_if(beg, end, [&](const auto& entry) { return &entry.second == genome; }));
+    }
+  }
+
+  // the operands of the genome, decoded by the first tile worker that runs it
+  const genome_t::ops_t& genome_store_t::ops(const genome_t* genome) {
+    TRACE_GENESIS;
+
+    if (!genome->decoded.load(std::memory_order_acquire)) {
+      std::lock_guard lock(mutex);
+      if (!genome->decoded.load(std::memory_order_relaxed)) {
+        decode(*genome);
+        genome->decoded.store(true, std::memory_order_release);
+      }
+    }
+    return genome->ops;
+  }
+
+  void genome_store_t::decode(const genome_t& genome) {
+    TRACE_GENESIS;
+
+    const auto& code = genome.code;
+
+    // rip is an uint8_t, the operands of the instruction at rip follow it with wrap-around
+    genome.ops.resize(ops_size);
+    for (size_t rip{}; rip < genome.ops.size(); ++rip) {
+      auto& op = genome.ops[rip];
+      op.cmd = rip % regs_size;
+      for (size_t i{}; i < std::size(op.reg); ++i) {
+        uint8_t arg = SAFE_INDEX(code, static_cast<uint8_t>(rip + 1 + i));
+        op.reg[i]   = arg % regs_size;
+        op.reg16[i] = arg % (regs_size - sizeof(uint16_t));
+      }
+      op.val8 = SAFE_INDEX(code, static_cast<uint8_t>(rip + 2));
+    }
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////
+
+  void cells_soa_t::init(const config_t& config) {
+    TRACE_GENESIS;
+
+    count             = config.x_max * config.y_max;
+    x_max             = config.x_max;
+    resources_count   = config.resources.size();
+    code_size         = config.code_size;
+    regs_size         = config.regs_size;
+
+    alive.assign(count, false);
+    family.assign(count, 0);
+    age.assign(count, 0);
+    direction.assign(count, 0);
+    energy_remaining.assign(count, 0);
+    resources_microbe.assign(count * resources_count, 0);
+    resources_cell.assign(count * resources_count, 0);
+    slot.assign(count, regs_arena_t::npos);
+    arena.init(count, regs_size);
+    genome.assign(count, nullptr);
+    genomes.init(code_size, regs_size);
+    live_slot.assign(count, regs_arena_t::npos);
+    live.clear();
+    tile_size         = config.update_tile_size;
+    tiles_x           = (config.x_max + tile_size - 1) / tile_size;
+    tiles_y           = (config.y_max + tile_size - 1) / tile_size;
+    tiles_dirty.assign(tiles_x * tiles_y, DIRTY_HASH);
+    rows_dirty.assign(tiles_x * tiles_y * tile_size, 0);
+    tiles_hash.assign(tiles_x * tiles_y, 0);
+  }
+
+  void cells_soa_t::alloc(size_t ind) {
+    TRACE_GENESIS;
+
+    if (slot[ind] == regs_arena_t::npos) {
+      slot[ind] = arena.alloc();
+    }
+    if (live_tracking && live_slot[ind] == regs_arena_t::npos) {
+      live_slot[ind] = live.size();
+      live.push_back(ind);
+    }
+    alive[ind] = true;
+  }
+
+  void cells_soa_t::kill(size_t ind) {
+    TRACE_GENESIS;
+
+    if (slot[ind] != regs_arena_t::npos) {
+      arena.release(slot[ind]);
+      slot[ind] = regs_arena_t::npos;
+    }
+
+    if (genome[ind]) {
+      genomes.release(genome[ind]);
+      genome[ind] = nullptr;
+    }
+
+    if (live_tracking && live_slot[ind] != regs_arena_t::npos) {
+      uint32_t ind_last = live.back();
+      live[live_slot[ind]] = ind_last;
+      live_slot[ind_last]  = live_slot[ind];
+      live.pop_back();
+      live_slot[ind] = regs_arena_t::npos;
+    }
+
+    alive[ind]              = false;
+    family[ind]             = {};
+    age[ind]                = {};
+    direction[ind]          = {};
+    energy_remaining[ind]   = {};
+    for (size_t res{}; res < resources_count; ++res) {
+      resources_microbe[res * count + ind] = {};
+    }
+  }
+
+  void cells_soa_t::swap_microbes(size_t ind1, size_t ind2) {
+    TRACE_GENESIS;
+
+    std::swap(alive[ind1],              alive[ind2]);
+    std::swap(family[ind1],             family[ind2]);
+    std::swap(age[ind1],                age[ind2]);
+    std::swap(direction[ind1],          direction[ind2]);
+    std::swap(energy_remaining[ind1],   energy_remaining[ind2]);
+    for (size_t res{}; res < resources_count; ++res) {
+      std::swap(resources_microbe[res * count + ind1], resources_microbe[res * count + ind2]);
+    }
+    std::swap(slot[ind1],               slot[ind2]);
+    std::swap(genome[ind1],             genome[ind2]);
+    if (live_tracking) {
+      std::swap(live_slot[ind1], live_slot[ind2]);
+      if (live_slot[ind1] != regs_arena_t::npos) {
+        live[live_slot[ind1]] = ind1;
+      }
+      if (live_slot[ind2] != regs_arena_t::npos) {
+        live[live_slot[ind2]] = ind2;
+      }
+    }
+  }
+
+  void cells_soa_t::set_genome(size_t ind, const genome_t* genome_n) {
+    TRACE_GENESIS;
+
+    // takes over a reference acquired from genomes
+    if (genome[ind]) {
+      genomes.release(genome[ind]);
+    }
+    genome[ind] = genome_n;
+    family[ind] = genome_n->family;
+  }
+
+  void cells_soa_t::rebuild_live(const std::vector<uint32_t>& live_prev) {
+    TRACE_GENESIS;
+
+    // A microbe moves or clones at most one cell away per tick, so every live cell
+    // is within the 8-neighbourhood of a cell that was live before the tick.
+    for (auto ind : live) {
+      live_slot[ind] = regs_arena_t::npos;
+    }
+    live.clear();
+
+    size_t y_max = count / x_max;
+    for (auto ind : live_prev) {
+      size_t x = ind % x_max;
+      size_t y = ind / x_max;
+      for (size_t yn = y ? y - 1 : y; yn <= y + 1 && yn < y_max; ++yn) {
+        for (size_t xn = x ? x - 1 : x; xn <= x + 1 && xn < x_max; ++xn) {
+          size_t ind_n = xn + yn * x_max;
+          if (alive[ind_n] && live_slot[ind_n] == regs_arena_t::npos) {
+            live_slot[ind_n] = live.size();
+            live.push_back(ind_n);
+          }
+        }
+      }
+    }
+  }
+
+  void cells_soa_t::mark_dirty(size_t ind, size_t radius) {
+    TRACE_GENESIS;
+
+    // workers of neighbouring tiles may mark the same tile, hence the atomic stores
+    auto mark = [](uint8_t& byte, uint8_t bits) {
+      std::atomic_ref<uint8_t> dirty(byte);
+      if (dirty.load(std::memory_order_relaxed) != bits) {
+        dirty.store(bits, std::memory_order_relaxed);
+      }
+    };
+
+    size_t x      = ind % x_max;
+    size_t y      = ind / x_max;
+    size_t tx_end = std::min(x + radius, x_max - 1) / tile_size;
+    size_t y_end  = std::min(y + radius, count / x_max - 1);
+    for (size_t row = y - std::min(y, radius); row <= y_end; ++row) {
+      for (size_t tx = (x - std::min(x, radius)) / tile_size; tx <= tx_end; ++tx) {
+        size_t tile = tx + row / tile_size * tiles_x;
+        mark(tiles_dirty[tile], DIRTY_CHECKPOINT | DIRTY_HASH);
+        mark(rows_dirty[tile * tile_size + row % tile_size], DIRTY_CHECKPOINT);
+      }
+    }
+  }
+
+  // every tile and row is in the next checkpoint, the one after a failed write
+  void cells_soa_t::mark_dirty_all() {
+    TRACE_GENESIS;
+
+    for (auto& dirty : tiles_dirty) {
+      dirty |= DIRTY_CHECKPOINT;
+    }
+    std::fill(rows_dirty.begin(), rows_dirty.end(), DIRTY_CHECKPOINT);
+  }
+
+  void cells_soa_t::clear_dirty() {
+    TRACE_GENESIS;
+
+    for (auto& dirty : tiles_dirty) {
+      dirty &= ~DIRTY_CHECKPOINT;
+    }
+    std::fill(rows_dirty.begin(), rows_dirty.end(), 0);
+  }
+
+  void cells_soa_t::load_microbe(size_t ind, const microbe_t& microbe) {
+    TRACE_GENESIS;
+
+    if (!microbe.alive) {
+      kill(ind);
+      return;
+    }
+
+    alloc(ind);
+    family[ind]             = microbe.family;
+    age[ind]                = microbe.age;
+    direction[ind]          = microbe.direction;
+    energy_remaining[ind]   = microbe.energy_remaining;
+    for (size_t res{}; res < resources_count; ++res) {
+      resources_microbe[res * count + ind] = microbe.resources[res];
+    }
+    std::copy_n(microbe.regs.begin(), regs_size, arena.regs(slot[ind]).begin());
+    set_genome(ind, genomes.intern(microbe.family, microbe.code));
+  }
+
+  void cells_soa_t::save_microbe(size_t ind, microbe_t& microbe) {
+    TRACE_GENESIS;
+
+    microbe = {};
+    if (!alive[ind]) {
+      return;
+    }
+
+    microbe.alive              = true;
+    const auto& code = genome[ind]->code;
+    auto regs = arena.regs(slot[ind]);
+    microbe.code.assign(code.begin(), code.end());
+    microbe.regs.assign(regs.begin(), regs.end());
+    microbe.family             = family[ind];
+    microbe.resources.resize(resources_count);
+    for (size_t res{}; res < resources_count; ++res) {
+      microbe.resources[res] = resources_microbe[res * count + ind];
+    }
+    microbe.pos                = {ind % x_max, ind / x_max};
+    microbe.age                = age[ind];
+    microbe.direction          = direction[ind];
+    microbe.energy_remaining   = energy_remaining[ind];
+  }
+
+  void cells_soa_t::load(size_t ind, const cell_t& cell) {
+    TRACE_GENESIS;
+
+    load_microbe(ind, cell.microbe);
+    for (size_t res{}; res < resources_count; ++res) {
+      resources_cell[res * count + ind] = cell.resources[res];
+    }
+  }
+
+  void cells_soa_t::save(size_t ind, cell_t& cell) {
+    TRACE_GENESIS;
+
+    save_microbe(ind, cell.microbe);
+    cell.resources.resize(resources_count);
+    for (size_t res{}; res < resources_count; ++res) {
+      cell.resources[res] = resources_cell[res * count + ind];
+    }
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////
+
+  thread_pool_t::thread_pool_t(size_t threads_count) {
+    TRACE_GENESIS;
+
+    for (size_t ind = 1; ind < threads_count; ++ind) {
+      threads.emplace_back([this] {
+        uint64_t generation_done = {};
+        while (true) {
+          std::unique_lock lock(mutex);
+          cv_task.wait(lock, [&] { return stop || generation != generation_done; });
+          if (stop) {
+            return;
+          }
+          generation_done = generation;
+          lock.unlock();
+
+          work();
+
+          lock.lock();
+          if (--pending == 0) {
+            cv_done.notify_one();
+          }
+        }
+      });
+    }
+  }
+
+  thread_pool_t::~thread_pool_t() {
+    TRACE_GENESIS;
+
+    {
+      std::lock_guard lock(mutex);
+      stop = true;
+    }
+    cv_task.notify_all();
+    for (auto& thread : threads) {
+      thread.join();
+    }
+  }
+
+  void thread_pool_t::run(size_t count, const task_t& task) {
+    TRACE_GENESIS;
+
+    {
+      std::lock_guard lock(mutex);
+      this->task  = &task;
+      tasks_count = count;
+      task_next   = 0;
+      pending     = threads.size();
+      generation++;
+    }
+    cv_task.notify_all();
+
+    work();
+
+    std::unique_lock lock(mutex);
+    cv_done.wait(lock, [&] { return pending == 0; });
+  }
+
+  void thread_pool_t::work() {
+    for (size_t ind = task_next++; ind < tasks_count; ind = task_next++) {
+      (*task)(ind);
+    }
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////
+
+  void profiler_t::refresh(stats_t& stats) {
+    TRACE_GENESIS;
+
+    if (++ticks > REFRESH && ticks % REFRESH) {
+      return;
+    }
+
+    window_t window;
+    for (size_t phase{}; phase < utils_t::PHASES_COUNT; ++phase) {
+      size_t size = std::min<uint64_t>(count[phase], WINDOW);
+      auto& phase_stats = stats.phases[phase];
+      if (!size) {
+        phase_stats = {};
+        continue;
+      }
+      std::copy_n(samples[phase].begin(), size, window.begin());
+      auto beg = window.begin();
+      auto p99 = beg + (size - 1) * 99 / 100;
+      auto p50 = beg + (size - 1) / 2;
+      std::nth_element(beg, p99, beg + size);
+      std::nth_element(beg, p50, p99);
+      phase_stats.p50 = *p50;
+      phase_stats.p99 = *p99;
+      phase_stats.max = *std::max_element(p99, beg + size);
+    }
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////
+
+  void scheduler_t::init(size_t schedule, size_t ticks_per_s) {
+    TRACE_GENESIS;
+
+    this->schedule    = schedule;
+    this->ticks_per_s = ticks_per_s;
+    period            = std::chrono::nanoseconds(ticks_per_s ? 1000000000 / ticks_per_s : 0);
+    tick_last         = clock_t::now();
+    tick_due          = tick_last;
+    window_end        = tick_last;
+    window_ticks      = {};
+    tasks.clear();
+  }
+
+  size_t scheduler_t::add(size_t interval_ms, task_run_t run) {
+    TRACE_GENESIS;
+
+    clock_t::duration interval = std::chrono::milliseconds(interval_ms);
+    tasks.push_back({.interval=interval, .due=clock_t::now() + interval, .run=std::move(run)});
+    return tasks.size() - 1;
+  }
+
+  bool scheduler_t::tick_ready(clock_t::time_point now) {
+    TRACE_GENESIS;
+
+    if (schedule == utils_t::SCHEDULE_RATE) {
+      return tick_due <= now;
+    } else if (schedule == utils_t::SCHEDULE_BUDGET) {
+      if (window_end <= now) {
+        window_end   = now + std::chrono::seconds(1);
+        window_ticks = {};
+      }
+      return window_ticks < ticks_per_s;
+    }
+    return true;
+  }
+
+  void scheduler_t::tick_done(clock_t::time_point now) {
+    TRACE_GENESIS;
+
+    tick_last = now;
+    window_ticks++;
+
+    // the ticks missed while the process was stopped or a tick ran long are dropped
+    tick_due += period;
+    if (tick_due + BACKLOG_MAX < now) {
+      tick_due = now;
+    }
+  }
+
+  void scheduler_t::run_tasks(clock_t::time_point now) {
+    TRACE_GENESIS;
+
+    for (auto& task : tasks) {
+      if (task.due > now) {
+        continue;
+      }
+      if (task.run(now)) {
+        task.due = std::max(task.due, now + task.interval);
+      } else {
+        task.due = now + WAIT_MAX;
+      }
+    }
+  }
+
+  // Sleeps until the next tick or task is due, WAIT_MAX at most, so the caller gets to
+  // what it does between the updates
+  void scheduler_t::wait(clock_t::time_point now) {
+    TRACE_GENESIS;
+
+    clock_t::time_point time_next = now + WAIT_MAX;
+    if (schedule == utils_t::SCHEDULE_RATE) {
+      time_next = std::min(time_next, tick_due);
+    } else if (schedule == utils_t::SCHEDULE_BUDGET && window_ticks >= ticks_per_s) {
+      time_next = std::min(time_next, window_end);
+    } else {
+      return;
+    }
+    for (const auto& task : tasks) {
+      time_next = std::min(time_next, task.due);
+    }
+    if (time_next > now) {
+      std::this_thread::sleep_until(time_next);
+    }
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////
+
+  void world_t::update() {
+    TRACE_GENESIS;
+
+    auto now = scheduler_t::clock_t::now();
+    if (scheduler.tick_ready(now)) {
+      stats.time_update = std::chrono::duration_cast<std::chrono::milliseconds>(now - scheduler.tick_last).count();
+      scheduler.tick_done(now);
+      update_world();
+      replay.update(*this);
+      if (config.hash_log_ticks && stats.age % config.hash_log_ticks == 0) {
+        // of this run from its first line, the logs of two runs compare line by line
+        if (!hash_log.is_open()) {
+          hash_log.open(world_file_name + ".hashes");
+        }
+        hash_log << stats.age << " " << std::hex << hash_tiles() << std::dec << std::endl;
+        if (!hash_log) {
+          LOG_GENESIS(ERROR, "can not write hash log");
+        }
+      }
+      now = scheduler_t::clock_t::now();
+    }
+
+    save_commit();
+    scheduler.run_tasks(now);
+
+    stats.time_save_write = save_write;
+
+    scheduler.wait(scheduler_t::clock_t::now());
+  }
+
+  void world_t::update_world() {
+    TRACE_GENESIS;
+
+    stats.microbes_count = {};
+    stats.microbes_age_avg = {};
+    stats.instructions = {};
+    stats.deaths = {};
+    stats.time_death = {};
+    stats.opcodes = {};
+
+    uint64_t time_tick = profiler_t::now();
+    uint64_t time_beg  = time_tick;
+
+    update_emission();
+    {
+      uint64_t time_end = profiler.lap(utils_t::PHASE_EMISSION, time_beg);
+      stats.time_emission = (time_end - time_beg) / 1000;
+      time_beg = time_end;
+    }
+
+    // Only microbes alive at the start of the tick are updated, each of them once.
+    live_order = cells.live;
+    std::sort(live_order.begin(), live_order.end());
+    if (owned_beg != xy_pos_t{} || owned_end.first < config.x_max || owned_end.second < config.y_max) {
+      std::erase_if(live_order, [&](uint32_t ind) { return !owned(ind); });
+    }
+
+    if (config.update_threads) {
+      update_world_tiles();
+    } else {
+      for (auto ind : live_order) {
+        if (cells.alive[ind]) {
+          update_cell(ind, stats);
+        }
+      }
+    }
+
+    time_beg = profiler.lap(utils_t::PHASE_MIND, time_beg);
+    profiler.record(utils_t::PHASE_DEATH, stats.time_death);
+
+    {
+      size_t count = stats.microbes_count;
+      if (count <= config.spawn_min_count) {
+        rand_t rand(seed, stats.age, utils_t::RAND_SPAWN);
+        for (; count < config.spawn_max_count; ++count) {
+          microbe_t microbe;
+          microbe.init(config, rand);
+          // signed, a shard's spawn position may be left of or above its grid
+          microbe.pos.first  = int64_t(std::floor(int64_t(config.spawn_pos.first)
+              + (rand() % config.spawn_radius - 0.5 * config.spawn_radius)));
+          microbe.pos.second = int64_t(std::floor(int64_t(config.spawn_pos.second)
+              + (rand() % config.spawn_radius - 0.5 * config.spawn_radius)));
+          if (microbe.validation(config, rand) && !cells.alive[xy_pos_to_ind(microbe.pos)]
+              && owned(xy_pos_to_ind(microbe.pos)))
+          {
+            update_mind_recipe(config.recipes[config.recipe_init], microbe);
+            cells.load_microbe(xy_pos_to_ind(microbe.pos), microbe);
+            cells.mark_dirty(xy_pos_to_ind(microbe.pos), 0);
+          } else {
+            // break;
+          }
+        }
+      }
+    }
+
+    profiler.lap(utils_t::PHASE_SPAWN, time_beg);
+
+    // stats
+    {
+      stats.age++;
+      stats.microbes_age_avg /= std::max(1UL, stats.microbes_count);
+      profiler.lap(utils_t::PHASE_TICK, time_tick);
+      profiler.refresh(stats);
+    }
+  }
+
+  // Draws the same random points as a per-point loop would and adds the precomputed
+  // falloff of each; only the draws stay sequential, the kernel lookups run in batches.
+  void world_t::update_emission() {
+    TRACE_GENESIS;
+
+    emission_batch_t batch;
+    for (size_t ind{}; ind < config.resources.size(); ++ind) {
+      auto&      resource_info = config.resources[ind];
+      res_val_t* resources     = cells.resources_cell.data() + ind * cells.size();
+      for (size_t area_ind{}; area_ind < resource_info.areas.size(); ++area_ind) {
+        auto& area = resource_info.areas[area_ind];
+        rand_t rand(seed, stats.age, utils_t::RAND_EMISSION + (ind << 16) + area_ind);
+        size_t count = area.frequency * 3.14 * area.radius * area.radius;
+        // a shard's areas may be centred left of or above its grid, the positions wrap around
+        int64_t pos_x  = area.pos.first;
+        int64_t pos_y  = area.pos.second;
+        int64_t radius = area.radius;
+        if (!count
+            || pos_x >= int64_t(config.x_max) + radius || pos_x + radius <= 0
+            || pos_y >= int64_t(config.y_max) + radius || pos_y + radius <= 0)
+        {
+          continue;
+        }
+        if (area.kernel.size() != (area.radius + 1) * (area.radius + 1)
+            || (area.emission == utils_t::EMISSION_EXPECTED && area.expected.size() != 4 * area.radius * area.radius))
+        {
+          area.init_kernel();
+        }
+        if (area.emission == utils_t::EMISSION_EXPECTED) {
+          update_emission_expected(area, resources, resource_info.stack_size, rand);
+          continue;
+        }
+
+        for (size_t beg{}; beg < count; beg += batch.count) {
+          batch.count = std::min(count - beg, emission_batch_t::SIZE);
+          for (size_t i{}; i < batch.count; ++i) {
+            batch.offset_x[i] = rand() % (2 * area.radius);
+            batch.offset_y[i] = rand() % (2 * area.radius);
+          }
+          batch.resolve(area, config.x_max, config.y_max);
+
+          for (size_t i{}; i < batch.count; ++i) {
+            if (batch.ind[i] == emission_batch_t::npos) {
+              continue;
+            }
+            auto& resource   = resources[batch.ind[i]];
+            auto  resource_n = std::clamp<int32_t>(resource + batch.delta[i], 0, resource_info.stack_size);
+            if (resource_n != resource) {
+              resource = resource_n;
+              cells.mark_dirty(batch.ind[i], 0);
+            }
+          }
+        }
+      }
+    }
+  }
+
+  // Adds the expected delta of the random emission to every cell the draws can reach, in one
+  // pass over the box. The fraction of the 16.16 delta is carried over by dithering in time:
+  // a cell gets the extra unit in frac of every 2^16 ticks, at a phase of its own, or with
+  // probability frac under stochastic rounding, its offsets four to a draw of a counter-based
+  // stream of the row.
+  void world_t::update_emission_expected(area_t& area, res_val_t* resources, res_val_t stack_size,
+      const rand_t& rand)
+  {
+    TRACE_GENESIS;
+
+    int64_t  side  = 2 * area.radius;
+    int64_t  x0    = int64_t(area.pos.first)  - int64_t(area.radius);
+    int64_t  y0    = int64_t(area.pos.second) - int64_t(area.radius);
+    size_t   x_beg = std::max<int64_t>(x0, 0);
+    size_t   y_beg = std::max<int64_t>(y0, 0);
+    size_t   x_end = std::min<int64_t>(x0 + side, config.x_max);
+    size_t   y_end = std::min<int64_t>(y0 + side, config.y_max);
+    uint32_t age   = stats.age;
+
+    // The row pass is instantiated per rounding and has no branch, so both vectorise; the
+    // tiles the row crosses are marked after it, all of them once any cell changed.
+    auto update_row = [&](size_t y, auto dither) {
+      const int32_t* expected = area.expected.data() + (y - y0) * side - x0;
+      res_val_t*     row      = resources + y * config.x_max;
+      uint32_t       row_ind  = y * config.x_max;
+      uint32_t       changed  = false;
+      for (uint32_t x = x_beg, x_last = x_end; x < x_last; ++x) {
+        uint32_t frac     = expected[x] & 0xFFFF;
+        uint32_t round    = ((dither(x, frac) & 0xFFFF) + frac) >> 16;
+        int32_t  resource = std::clamp<int32_t>(row[x] + (expected[x] >> 16) + round, 0, stack_size);
+        changed |= resource != row[x];
+        row[x] = resource;
+      }
+      if (changed) {
+        for (size_t x = x_beg; x < x_end; x = (x / cells.tile_size + 1) * cells.tile_size) {
+          cells.mark_dirty(row_ind + x, 0);
+        }
+      }
+    };
+
+    // the offsets of a row are filled first, the phase of a cell is its index hashed
+    emission_row.resize((x_end - x_beg + 3) & ~size_t{3});
+    const uint16_t* offsets = emission_row.data() - x_beg;
+    for (size_t y = y_beg; y < y_end; ++y) {
+      if (area.stochastic_rounding) {
+        for (size_t i{}; i < emission_row.size(); i += 4) {
+          uint64_t draw = rand.at((uint64_t(y) << 32) + i / 4);
+          std::memcpy(&emission_row[i], &draw, sizeof(draw));
+        }
+        update_row(y, [&](uint32_t x, uint32_t) {
+          return uint32_t(offsets[x]);
+        });
+      } else {
+        uint32_t phase = uint32_t(y * config.x_max + x_beg) * 0x9E3779B1U;
+        for (auto& offset : emission_row) {
+          offset = phase >> 16;
+          phase += 0x9E3779B1U;
+        }
+        update_row(y, [&](uint32_t x, uint32_t frac) {
+          return uint32_t(uint16_t(age * frac) + offsets[x]);
+        });
+      }
+    }
+  }
+
+  void world_t::update_world_tiles() {
+    TRACE_GENESIS;
+
+    if (!pool || pool->size() != config.update_threads) {
+      pool = std::make_unique<thread_pool_t>(config.update_threads);
+    }
+
+    // Tiles of one colour of the 2x2 checkerboard are a whole tile apart, and a microbe
+    // touches only its 8-neighbourhood, so the tiles of a colour can be updated concurrently.
+    size_t tile_size = config.update_tile_size;
+    size_t tiles_x   = (config.x_max + tile_size - 1) / tile_size;
+    size_t tiles_y   = (config.y_max + tile_size - 1) / tile_size;
+
+    auto tile_of = [&](size_t ind) {
+      return (ind % config.x_max) / tile_size + (ind / config.x_max) / tile_size * tiles_x;
+    };
+
+    tiles_beg.assign(tiles_x * tiles_y + 1, 0);
+    for (auto ind : live_order) {
+      tiles_beg[tile_of(ind) + 1]++;
+    }
+    for (size_t tile{}; tile < tiles_x * tiles_y; ++tile) {
+      tiles_beg[tile + 1] += tiles_beg[tile];
+    }
+    live_tiles.resize(live_order.size());
     {
-      for (size_t ind{}; ind < config.resources.size(); ++ind) {
-        const auto& resource_info = config.resources[ind];
-        for (const auto& area : resource_info.areas) {
-          size_t count = area.frequency * 3.14 * area.radius * area.radius;
-          for (size_t i{}; i < count; ++i) {
-            size_t x = area.pos.first  + utils_t::rand_u64() % (2 * area.radius) - area.radius;
-            size_t y = area.pos.second + utils_t::rand_u64() % (2 * area.radius) - area.radius;
-            xy_pos_t pos = {x, y};
-            size_t dist = utils_t::distance(pos, area.pos);
-            double resource_delta = area.factor * std::max(0.,
-                1. - std::pow(std::abs(1. * dist / area.radius), area.sigma));
-            if (pos_valid(pos)) {
-              size_t xy_ind = xy_pos_to_ind(pos);
-              auto& resource = cells[xy_ind].resources[ind];
-              resource += resource_delta;
-              utils_t::normalize(resource, 0, resource_info.stack_size);
-            }
-          }
-        }
+      std::vector<size_t> tiles_pos(tiles_beg.begin(), tiles_beg.end() - 1);
+      for (auto ind : live_order) {
+        live_tiles[tiles_pos[tile_of(ind)]++] = ind;
       }
     }
 
-    for (auto& cell : cells) {
-      cell.microbe.energy_remaining = config.energy_remaining;
-    }
+    std::vector<size_t>  tiles;
+    std::vector<stats_t> tiles_stats;
 
-    for (size_t ind{}; ind < cells.size(); ++ind) {
-      auto& cell = cells[ind];
-      auto& microbe = cell.microbe;
+    // workers must not reorder cells.live concurrently, it is rebuilt after the phases
+    cells.live_tracking = false;
 
-      if (!microbe.alive) {
-        continue;
+    for (size_t color{}; color < 4; ++color) {
+      tiles.clear();
+      for (size_t ty = color / 2; ty < tiles_y; ty += 2) {
+        for (size_t tx = color % 2; tx < tiles_x; tx += 2) {
+          size_t tile = tx + ty * tiles_x;
+          if (tiles_beg[tile] != tiles_beg[tile + 1]) {
+            tiles.push_back(tile);
+          }
+        }
       }
-
-      while (microbe.energy_remaining > 0) {
-        microbe.energy_remaining--;
-        update_mind(microbe);
-        size_t ind_n = xy_pos_to_ind(microbe.pos);
-        if (ind_n != ind) {
-          auto& microbe_n = cells[ind_n].microbe;
-          std::swap(microbe, microbe_n);
-          break; // TODO
+      tiles_stats.assign(tiles.size(), {});
+
+      pool->run(tiles.size(), [&](size_t task) {
+        size_t tile = tiles[task];
+        for (size_t i = tiles_beg[tile]; i < tiles_beg[tile + 1]; ++i) {
+          size_t ind = live_tiles[i];
+          if (cells.alive[ind]) {
+            update_cell(ind, tiles_stats[task]);
+          }
+        }
+      });
+
+      for (const auto& tile_stats : tiles_stats) {
+        stats.microbes_count   += tile_stats.microbes_count;
+        stats.microbes_age_avg += tile_stats.microbes_age_avg;
+        stats.instructions     += tile_stats.instructions;
+        stats.deaths           += tile_stats.deaths;
+        stats.time_death       += tile_stats.time_death;
+        for (size_t ind{}; ind < utils_t::OPCODES_COUNT; ++ind) {
+          stats.opcodes[ind]   += tile_stats.opcodes[ind];
         }
       }
+    }
 
-      if (!microbe.alive) {
-        continue;
-      }
+    cells.live_tracking = true;
+    cells.rebuild_live(live_order);
+  }
 
-      if (microbe.age <= 0 || microbe.resources[utils_t::RES_ENERGY] <= 0) {
-        for (size_t i{}; i < config.resources.size(); ++i) {
-          cell.resources[i] += microbe.resources[i] / 2;
-          utils_t::normalize(cell.resources[i], 0, config.resources[i].stack_size);
-        }
-        microbe = {};
-        microbe.alive = false;
-        continue;
-      }
+  void world_t::update_cell(size_t ind, stats_t& stats_tile) {
+    TRACE_GENESIS;
 
-      update_mind_recipe(config.recipes[config.recipe_step], microbe);
+    rand_t rand(seed, stats.age, global_ind(ind));
 
-      microbe.age--;
-      stats.microbes_count++;
-      stats.microbes_age_avg += microbe.age;
-    }
+    // its own cell changes every tick; a move, a clone, an attack or an exchange marks the
+    // neighbour it writes
+    cells.mark_dirty(ind, 0);
 
+    // a microbe that moved is aged at its new cell, it is not updated there again this tick
+    size_t ind_n = ind;
     {
-      size_t count = stats.microbes_count;
-      if (count <= config.spawn_min_count) {
-        for (; count < config.spawn_max_count; ++count) {
-          microbe_t microbe;
-          microbe.init(config);
-          microbe.pos = config.spawn_pos;
-          microbe.pos.first  += utils_t::rand_u64() % config.spawn_radius - 0.5 * config.spawn_radius;
-          microbe.pos.second += utils_t::rand_u64() % config.spawn_radius - 0.5 * config.spawn_radius;
-          size_t ind = xy_pos_to_ind(microbe.pos);
-          auto& microbe_n = cells[ind].microbe;
-          if (microbe.validation(config) && !microbe_n.alive) {
-            update_mind_recipe(config.recipes[config.recipe_init], microbe);
-            microbe_n = std::move(microbe);
-          } else {
-            // break;
+      auto microbe = cells[ind].microbe;
+      microbe.energy_remaining = config.energy_remaining;
+      if (config.mind_backend == utils_t::MIND_THREADED) {
+        update_mind_threaded(microbe, rand, stats_tile);
+      } else {
+        while (microbe.energy_remaining > 0) {
+          microbe.energy_remaining--;
+          update_mind(microbe, rand, stats_tile);
+          if (xy_pos_to_ind(microbe.pos) != ind) {
+            break;
           }
         }
       }
+      stats_tile.instructions += config.energy_remaining - microbe.energy_remaining;
+      ind_n = xy_pos_to_ind(microbe.pos);
+      if (ind_n != ind) {
+        cells.swap_microbes(ind, ind_n);
+        cells.mark_dirty(ind_n, 0);
+      }
     }
 
-    // stats
-    {
-      stats.age++;
-      stats.microbes_age_avg /= std::max(1UL, stats.microbes_count);
+    auto cell = cells[ind_n];
+    auto& microbe = cell.microbe;
+
+    if (microbe.age <= 0 || microbe.resources[utils_t::RES_ENERGY] <= 0) {
+      uint64_t time_beg = profiler_t::now();
+      for (size_t i{}; i < config.resources.size(); ++i) {
+        cell.resources[i] += microbe.resources[i] / 2;
+        utils_t::normalize(cell.resources[i], 0, config.resources[i].stack_size);
+      }
+      cells.kill(ind_n);
+      stats_tile.deaths++;
+      stats_tile.time_death += profiler_t::now() - time_beg;
+      return;
     }
+
+    update_mind_recipe(config.recipes[config.recipe_step], microbe);
+
+    microbe.age--;
+    stats_tile.microbes_count++;
+    stats_tile.microbes_age_avg += microbe.age;
   }
 
-  void world_t::update_mind(microbe_t& microbe) {
+  void world_t::update_mind(microbe_ref_t& microbe, rand_t& rand, stats_t& stats_tile) {
     TRACE_GENESIS;
 
     LOG_GENESIS(MIND, "family: %zd", microbe.family);
@@ -1076,187 +3458,848 @@ namespace genesis_n {
 
         LOG_GENESIS(MIND, "TURN <%zd>=%zd", reg, dir);
 
-        microbe.direction = (microbe.direction + dir) % utils_t::direction_max;
-        break;
+        microbe.direction = (microbe.direction + dir) % utils_t::direction_max;
+        break;
+
+      } case 17: {
+        /*
+        uint8_t args = SAFE_INDEX(bacteria->code, bacteria->rip++);
+        uint8_t arg1 = SAFE_INDEX(bacteria->code, utils_t::fasthash64(args++, bacteria->code[0]));
+        uint8_t arg2 = SAFE_INDEX(bacteria->code, utils_t::fasthash64(args++, bacteria->code[0]));
+        uint8_t arg3 = SAFE_INDEX(bacteria->code, utils_t::fasthash64(args++, bacteria->code[0]));
+        bacteria->direction = (bacteria->direction + arg1) % 8;
+        LOG_GENESIS(MIND, "LOOK <%d> <%d> <%d> <%d>", args, arg1, arg2, arg3);
+        */
+        // TODO
+        break;
+
+      } case 18: {
+        LOG_GENESIS(MIND, "MOVE");
+
+        mind_move(microbe);
+        break;
+
+      } case 19: {
+        uint8_t reg = SAFE_INDEX(code, rip++);
+        uint8_t dir = SAFE_INDEX(regs, reg);
+
+        LOG_GENESIS(MIND, "CLONE <%zd>=%zd", reg, dir);
+
+        mind_clone(microbe, dir, rand);
+        break;
+
+      } case 20: {
+        uint8_t reg = SAFE_INDEX(code, rip++);
+        uint8_t ind = SAFE_INDEX(regs, reg);
+
+        LOG_GENESIS(MIND, "RECIPE <%zd>=%zd", reg, ind);
+
+        mind_recipe(microbe, ind);
+        break;
+
+      } case 21: {
+        uint8_t reg1 = SAFE_INDEX(code, rip++);
+        uint8_t reg2 = SAFE_INDEX(code, rip++);
+
+        uint8_t  dir = SAFE_INDEX(regs, reg1);
+        uint16_t strength;
+        utils_t::load_data(strength, regs, reg2);
+
+        LOG_GENESIS(MIND, "ATTACK <%d>=%zd <%d>=%zd", reg1, dir, reg2, strength);
+
+        mind_attack(microbe, dir, strength);
+        break;
+
+      } case 22: {
+        uint8_t reg1 = SAFE_INDEX(code, rip++);
+        uint8_t reg2 = SAFE_INDEX(code, rip++);
+        uint8_t reg3 = SAFE_INDEX(code, rip++);
+
+        uint8_t dir = SAFE_INDEX(regs, reg1);
+        uint8_t res = SAFE_INDEX(regs, reg2);
+        res_val_t val;
+        utils_t::load_data(val, regs, reg3);
+
+        LOG_GENESIS(MIND, "RESOURCE EXCHANGE <%zd>=%zd <%zd>=%zd <%zd>=%zd",
+            reg1, dir, reg2, res, reg3, val);
+
+        mind_exchange(microbe, dir, res, val);
+        break;
+
+      } default: {
+        LOG_GENESIS(MIND, "NOTHING");
+        break;
+      }
+    }
+
+    SAFE_INDEX(regs, utils_t::REG_RIP1B) = rip;
+
+    // counted last, a store through stats_tile would make the handlers reload the microbe
+    stats_tile.opcodes[utils_t::opcodes_ind[cmd]]++;
+  }
+
+  // Same instruction set as update_mind, but it runs instructions until the energy runs out
+  // or the microbe moves, and every handler jumps straight to the next one through a label
+  // table (computed goto on GCC/Clang). Operands come pre-decoded from the family genome.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+  void world_t::update_mind_threaded(microbe_ref_t& microbe, rand_t& rand, stats_t& stats_tile) {
+    TRACE_GENESIS;
+
+    LOG_GENESIS(MIND, "family: %zd", microbe.family);
+
+    auto& regs     = microbe.regs;
+    auto  pos      = microbe.pos;
+    auto& ops      = cells.genomes.ops(cells.genome[xy_pos_to_ind(pos)]);
+    auto  ops_mask = ops.size() - 1;
+
+    // the handlers are in the order of utils_t::opcodes
+    static constexpr const auto& handlers_ind = utils_t::opcodes_ind;
+
+#if defined(__GNUC__)
+    static void* handlers[] = {
+      &&cmd_default, &&cmd_0, &&cmd_1, &&cmd_2, &&cmd_3, &&cmd_4, &&cmd_5, &&cmd_6,
+      &&cmd_16, &&cmd_17, &&cmd_18, &&cmd_19, &&cmd_20, &&cmd_21, &&cmd_22 };
+    #define MIND_DISPATCH   goto *handlers[handlers_ind[cmd]]
+#else
+    #define MIND_DISPATCH   goto dispatch
+#endif
+
+    // rip stays at the current instruction, handlers advance it past their operands
+    #define MIND_NEXT(len)   \
+      rip += len;   \
+      regs[utils_t::REG_RIP1B] = rip;   \
+      if (microbe.energy_remaining <= 0) {   \
+        return;   \
+      }   \
+      microbe.energy_remaining--;   \
+      op  = &ops[rip & ops_mask];   \
+      cmd = regs[op->cmd];   \
+      LOG_GENESIS(MIND, "rip: %d cmd: %d", rip, cmd);   \
+      stats_tile.opcodes[handlers_ind[cmd]]++;   \
+      MIND_DISPATCH
+
+    uint8_t rip = regs[utils_t::REG_RIP1B];
+    uint8_t cmd = {};
+    const decoded_op_t* op = {};
+
+    MIND_NEXT(0);
+
+#if !defined(__GNUC__)
+    dispatch:
+    switch (handlers_ind[cmd]) {
+      case 1:  goto cmd_0;
+      case 2:  goto cmd_1;
+      case 3:  goto cmd_2;
+      case 4:  goto cmd_3;
+      case 5:  goto cmd_4;
+      case 6:  goto cmd_5;
+      case 7:  goto cmd_6;
+      case 8:  goto cmd_16;
+      case 9:  goto cmd_17;
+      case 10: goto cmd_18;
+      case 11: goto cmd_19;
+      case 12: goto cmd_20;
+      case 13: goto cmd_21;
+      case 14: goto cmd_22;
+      default: goto cmd_default;
+    }
+#endif
+
+    cmd_0: {
+      LOG_GENESIS(MIND, "NOP");
+      MIND_NEXT(1);
+
+    } cmd_1: {
+      uint8_t offset = regs[op->reg[0]];
+
+      LOG_GENESIS(MIND, "BR <%d>=%d", op->reg[0], offset);
+
+      MIND_NEXT(2 + offset);
+
+    } cmd_2: {
+      uint8_t offset = regs[op->reg[0]];
+
+      LOG_GENESIS(MIND, "BR_ABS <%d>=%d", op->reg[0], offset);
+
+      rip = offset;
+      MIND_NEXT(0);
+
+    } cmd_3: {
+      LOG_GENESIS(MIND, "SET_U8 <%d> <%d>", op->reg[0], op->val8);
+
+      regs[op->reg[0]] = op->val8;
+      MIND_NEXT(3);
+
+    } cmd_4: {
+      uint16_t val;
+      utils_t::load_data(val, microbe.code, static_cast<uint8_t>(rip + 2));
+
+      LOG_GENESIS(MIND, "SET_U16 <%d> <%d>", op->reg16[0], val);
+
+      std::memcpy(&regs[op->reg16[0]], &val, sizeof(val));
+      MIND_NEXT(4);
+
+    } cmd_5: {
+      LOG_GENESIS(MIND, "ADD_U8 <%d> <%d> <%d>", op->reg[0], op->reg[1], op->reg[2]);
+
+      regs[op->reg[2]] = regs[op->reg[0]] + regs[op->reg[1]];
+      MIND_NEXT(4);
+
+    } cmd_6: {
+      LOG_GENESIS(MIND, "SUB_U8 <%d> <%d> <%d>", op->reg[0], op->reg[1], op->reg[2]);
+
+      regs[op->reg[2]] = regs[op->reg[0]] - regs[op->reg[1]];
+      MIND_NEXT(4);
+
+    } cmd_16: {
+      uint8_t dir = regs[op->reg[0]];
+
+      LOG_GENESIS(MIND, "TURN <%d>=%d", op->reg[0], dir);
+
+      microbe.direction = (microbe.direction + dir) % utils_t::direction_max;
+      MIND_NEXT(2);
+
+    } cmd_17: {
+      // TODO LOOK
+      MIND_NEXT(1);
+
+    } cmd_18: {
+      LOG_GENESIS(MIND, "MOVE");
+
+      mind_move(microbe);
+      if (microbe.pos != pos) {
+        regs[utils_t::REG_RIP1B] = rip + 1;
+        return;
+      }
+      MIND_NEXT(1);
+
+    } cmd_19: {
+      uint8_t dir = regs[op->reg[0]];
+
+      LOG_GENESIS(MIND, "CLONE <%d>=%d", op->reg[0], dir);
+
+      mind_clone(microbe, dir, rand);
+      MIND_NEXT(2);
+
+    } cmd_20: {
+      uint8_t ind = regs[op->reg[0]];
+
+      LOG_GENESIS(MIND, "RECIPE <%d>=%d", op->reg[0], ind);
+
+      mind_recipe(microbe, ind);
+      MIND_NEXT(2);
+
+    } cmd_21: {
+      uint8_t  dir = regs[op->reg[0]];
+      uint16_t strength;
+      std::memcpy(&strength, &regs[op->reg16[1]], sizeof(strength));
+
+      LOG_GENESIS(MIND, "ATTACK <%d>=%d <%d>=%d", op->reg[0], dir, op->reg16[1], strength);
+
+      mind_attack(microbe, dir, strength);
+      MIND_NEXT(3);
+
+    } cmd_22: {
+      uint8_t   dir = regs[op->reg[0]];
+      uint8_t   res = regs[op->reg[1]];
+      res_val_t val;
+      std::memcpy(&val, &regs[op->reg16[2]], sizeof(val));
+
+      LOG_GENESIS(MIND, "RESOURCE EXCHANGE <%d>=%d <%d>=%d <%d>=%d",
+          op->reg[0], dir, op->reg[1], res, op->reg16[2], val);
+
+      mind_exchange(microbe, dir, res, val);
+      MIND_NEXT(4);
+
+    } cmd_default: {
+      LOG_GENESIS(MIND, "NOTHING");
+      MIND_NEXT(1);
+    }
+
+    #undef MIND_NEXT
+    #undef MIND_DISPATCH
+  }
+#pragma GCC diagnostic pop
+
+  void world_t::mind_move(microbe_ref_t& microbe) {
+    TRACE_GENESIS;
+
+    auto pos = microbe.pos;
+    auto pos_n = pos_next(pos, microbe.direction);
+    uint64_t ind = xy_pos_to_ind(pos_n);
+    if (pos != pos_n && !cells.alive[ind]) {
+      microbe.pos = pos_n;
+    }
+  }
+
+  void world_t::mind_clone(microbe_ref_t& microbe, uint8_t dir, rand_t& rand) {
+    TRACE_GENESIS;
+
+    const auto& code = microbe.code;
+    const auto& regs = microbe.regs;
+
+    double probability = config.mutation_probability * 0xFFFF / (code.size() + regs.size());
+    auto pos_n         = pos_next(microbe.pos, dir);
+    auto ind           = xy_pos_to_ind(pos_n);
+
+    if (!cells.alive[ind] && update_mind_recipe(config.recipes[config.recipe_clone], microbe)) {
+      cells.alloc(ind);
+      cells.mark_dirty(ind, 0);
+      auto microbe_child = cells[ind].microbe;
+      microbe_child.init(config, rand);
+
+      // the child shares the parent's genome unless a code byte mutates
+      microbe_t::data_t code_mutated;
+      for (size_t i{}; i < code.size(); ++i) {
+        if (rand() % 0xFFFF < probability) {
+          if (code_mutated.empty()) {
+            code_mutated.assign(code.begin(), code.end());
+          }
+          code_mutated[i] = rand();
+        }
+      }
+      if (code_mutated.empty()) {
+        cells.set_genome(ind, cells.genomes.acquire(cells.genome[xy_pos_to_ind(microbe.pos)]));
+      } else {
+        cells.set_genome(ind, cells.genomes.intern(code_mutated));
+      }
+
+      std::copy(regs.begin(), regs.end(), microbe_child.regs.begin());
+      microbe_child.pos    = pos_n;
+      for (auto& byte : microbe_child.regs) {
+        if (rand() % 0xFFFF < probability) {
+          byte = rand();
+        }
+      }
+      if (microbe_child.validation(config)) {
+        update_mind_recipe(config.recipes[config.recipe_init], microbe_child);
+      } else {
+        cells.kill(ind);
+      }
+    }
+  }
+
+  void world_t::mind_recipe(microbe_ref_t& microbe, uint8_t ind) {
+    TRACE_GENESIS;
+
+    const auto& recipe = config.recipes[ind % config.recipes.size()];
+    if (recipe.available) {
+      update_mind_recipe(recipe, microbe);
+    }
+  }
+
+  void world_t::mind_attack(microbe_ref_t& microbe, uint8_t dir, uint16_t strength) {
+    TRACE_GENESIS;
+
+    auto stack_size = config.resources[utils_t::RES_ENERGY].stack_size;
+    strength %= stack_size;
+
+    auto pos_n = pos_next(microbe.pos, dir);
+    uint64_t ind = xy_pos_to_ind(pos_n);
+
+    auto  microbe_attacked = cells[ind].microbe;
+    auto& energy           = microbe.resources[utils_t::RES_ENERGY];
+    auto& energy_attacked  = microbe_attacked.resources[utils_t::RES_ENERGY];
+
+    // a halo cell is a copy of a neighbour shard's cell, the next exchange of the halo
+    // would undo the loss and keep the gain
+    if (microbe.pos != pos_n
+        && owned(pos_n)
+        && energy > strength
+        && microbe_attacked.alive)
+    {
+      energy -= strength;
+      energy_attacked -= strength;
+      cells.mark_dirty(ind, 0);
+
+      utils_t::normalize(energy, 0, stack_size);
+      utils_t::normalize(energy_attacked, 0, stack_size);
+    }
+  }
+
+  void world_t::mind_exchange(microbe_ref_t& microbe, uint8_t dir, uint8_t res, res_val_t val) {
+    TRACE_GENESIS;
+
+    size_t resource         = res % config.resources.size();
+    auto   pos_n            = pos_next(microbe.pos, dir);
+    size_t ind              = xy_pos_to_ind(pos_n);
+    auto   stack_size       = config.resources[resource].stack_size;
+    auto&  microbe_resource = microbe.resources[resource];
+    auto&  cell_resource    = cells.resources_cell[resource * cells.size() + ind];
+
+    if (owned(pos_n)
+        && microbe_resource + val >= 0
+        && microbe_resource + val <= stack_size
+        && cell_resource - val >= 0
+        && cell_resource - val <= stack_size)
+    {
+      microbe_resource += val;
+      cell_resource -= val;
+      cells.mark_dirty(ind, 0);
+    }
+  }
+
+  bool world_t::update_mind_recipe(const recipe_t& recipe, auto& microbe) {
+    auto& resources = microbe.resources;
+
+    for (const auto& [ind, count] : recipe.in_out) {
+      const auto& resource_info = config.resources[ind];
+      auto count_n = resources[ind] + count;
+      if (count_n < 0 || count_n > resource_info.stack_size) {
+        return false;
+      }
+    }
+
+    for (const auto& [ind, count] : recipe.in_out) {
+      const auto& resource_info = config.resources[ind];
+      auto count_n = count;
+
+      auto& resource = resources[ind];
+      resource += count_n;
+      utils_t::normalize(resource, 0, resource_info.stack_size);
+      LOG_GENESIS(MIND, "resource %zd", resource);
+    }
+
+    return true;
+  }
+
+  void world_t::init() {
+    TRACE_GENESIS;
+
+    load_config();
+
+    utils_t::set_debug(config.debug);
+    if (config.seed) {
+      seed = config.seed;
+    } else if (!seed) {
+      seed = time(0);
+    }
+
+    load_data();
+
+    save_config();
+    // save_data();
+
+    if (config.replay_keyframe_ticks && !replay.open(*this)) {
+      LOG_GENESIS(ERROR, "can not start replay log");
+      throw std::runtime_error("can not start replay log");
+    }
+
+    init_scheduler();
+  }
+
+  // The saves, the checkpoints between them and the stats hook; a save puts the next
+  // checkpoint an interval after it. Called again when the config is reloaded.
+  void world_t::init_scheduler() {
+    TRACE_GENESIS;
+
+    scheduler.init(config.schedule, config.ticks_per_s);
+
+    // a new world is saved at once, the checkpoints need a full save to apply to
+    size_t save = scheduler.add(config.interval_save_world_ms, {});
+    if (!checkpoint_base) {
+      scheduler.tasks[save].due = scheduler_t::clock_t::now();
+    }
+    size_t checkpoint = utils_t::npos;
+    if (config.interval_checkpoint_ms) {
+      checkpoint = scheduler.add(config.interval_checkpoint_ms, [this](auto) {
+        uint64_t time_save = profiler_t::now();
+        if (!save_delta_async()) {
+          return false;
+        }
+        LOG_GENESIS(TIME, "checkpoint %zd", stats.age);
+        profiler.lap(utils_t::PHASE_SAVE, time_save);
+        return true;
+      });
+    }
+
+    // a save that comes due while the previous one is being written is postponed;
+    // the save phase is the part the simulation waits for, the copy and the stall
+    scheduler.tasks[save].run = [this, checkpoint](auto now) {
+      uint64_t time_save = profiler_t::now();
+      if (!save_data_async()) {
+        return false;
+      }
+      LOG_GENESIS(TIME, "save %zd", stats.age);
+      if (checkpoint != utils_t::npos) {
+        scheduler.postpone(checkpoint, now);
+      }
+      profiler.lap(utils_t::PHASE_SAVE, time_save);
+      return true;
+    };
+
+    if (config.interval_stats_ms) {
+      scheduler.add(config.interval_stats_ms, [this](auto) {
+        if (stats_hook) {
+          stats_hook(*this);
+        }
+        return true;
+      });
+    }
+  }
 
-      } case 17: {
-        /*
-        uint8_t args = SAFE_INDEX(bacteria->code, bacteria->rip++);
-        uint8_t arg1 = SAFE_INDEX(bacteria->code, utils_t::fasthash64(args++, bacteria->code[0]));
-        uint8_t arg2 = SAFE_INDEX(bacteria->code, utils_t::fasthash64(args++, bacteria->code[0]));
-        uint8_t arg3 = SAFE_INDEX(bacteria->code, utils_t::fasthash64(args++, bacteria->code[0]));
-        bacteria->direction = (bacteria->direction + arg1) % 8;
-        LOG_GENESIS(MIND, "LOOK <%d> <%d> <%d> <%d>", args, arg1, arg2, arg3);
-        */
-        // TODO
-        break;
+  uint64_t world_t::hash() {
+    TRACE_GENESIS;
 
-      } case 18: {
-        LOG_GENESIS(MIND, "MOVE");
+    uint64_t h = seed;
+    auto hash_plane = [&h](const auto& plane) {
+      h = utils_t::fasthash64(plane.data(), plane.size() * sizeof(plane[0]), h);
+    };
+
+    hash_plane(cells.alive);
+    hash_plane(cells.family);
+    hash_plane(cells.age);
+    hash_plane(cells.direction);
+    hash_plane(cells.resources_microbe);
+    hash_plane(cells.resources_cell);
+    for (size_t ind{}; ind < cells.size(); ++ind) {
+      if (cells.alive[ind]) {
+        auto microbe = cells[ind].microbe;
+        hash_plane(microbe.code);
+        hash_plane(microbe.regs);
+      }
+    }
+    h = utils_t::fasthash64(&stats.age, sizeof(stats.age), h);
+    h = utils_t::fasthash64(&stats.microbes_count, sizeof(stats.microbes_count), h);
 
-        auto pos = microbe.pos;
-        auto pos_n = pos_next(pos, microbe.direction);
-        uint64_t ind = xy_pos_to_ind(pos_n);
-        if (pos != pos_n && !cells[ind].microbe.alive) {
-          microbe.pos = pos_n;
-        }
+    return h;
+  }
 
-        break;
+  // The world hash from a hash per tile, of its resources and of its live microbes; a tile
+  // is hashed again only once cells_soa_t::mark_dirty marked it, so a call costs the tiles
+  // the ticks since the last one touched. Cells changed outside update_world are seen once
+  // marked, as for the checkpoints. With full every tile is hashed, the check of the rest.
+  // Differs from hash(), which stays the reference of the benchmarks.
+  uint64_t world_t::hash_tiles(bool full) {
+    TRACE_GENESIS;
 
-      } case 19: {
-        uint8_t reg = SAFE_INDEX(code, rip++);
-        uint8_t dir = SAFE_INDEX(regs, reg);
+    std::vector<uint32_t> tiles;
+    for (size_t tile{}; tile < cells.tiles_dirty.size(); ++tile) {
+      if (full || (cells.tiles_dirty[tile] & cells_soa_t::DIRTY_HASH)) {
+        tiles.push_back(tile);
+        cells.tiles_dirty[tile] &= ~cells_soa_t::DIRTY_HASH;
+      }
+    }
 
-        LOG_GENESIS(MIND, "CLONE <%zd>=%zd", reg, dir);
+    auto hash_tile = [&](size_t task) {
+      size_t tile  = tiles[task];
+      size_t x_beg = tile % cells.tiles_x * cells.tile_size;
+      size_t y_beg = tile / cells.tiles_x * cells.tile_size;
+      size_t x_end = std::min(x_beg + cells.tile_size, config.x_max);
+      size_t y_end = std::min(y_beg + cells.tile_size, config.y_max);
+      size_t count = cells.size();
+
+      uint64_t h = tile;
+      for (size_t res{}; res < cells.resources_count; ++res) {
+        for (size_t y = y_beg; y < y_end; ++y) {
+          h = utils_t::fasthash64(&cells.resources_cell[res * count + x_beg + y * config.x_max],
+              (x_end - x_beg) * sizeof(res_val_t), h);
+        }
+      }
 
-        double probability = config.mutation_probability * 0xFFFF / (code.size() + regs.size());
-        auto pos_n         = pos_next(microbe.pos, dir);
-        auto ind           = xy_pos_to_ind(pos_n);
-        auto& microbe_n    = cells[ind].microbe;
-
-        if (!microbe_n.alive && update_mind_recipe(config.recipes[config.recipe_clone], microbe)) {
-          microbe_t microbe_child = {};
-          microbe_child.init(config);
-
-          microbe_child.code   = microbe.code;
-          microbe_child.regs   = microbe.regs;
-          microbe_child.pos    = pos_n;
-          for (auto& byte : microbe_child.code) {
-            if (utils_t::rand_u64() % 0xFFFF < probability) {
-              byte = utils_t::rand_u64();
-            }
+      std::vector<res_val_t> resources(cells.resources_count);
+      for (size_t y = y_beg; y < y_end; ++y) {
+        for (size_t ind = x_beg + y * config.x_max; ind < x_end + y * config.x_max; ++ind) {
+          if (!cells.alive[ind]) {
+            continue;
           }
-          for (auto& byte : microbe_child.regs) {
-            if (utils_t::rand_u64() % 0xFFFF < probability) {
-              byte = utils_t::rand_u64();
-            }
-          }
-          if (microbe_child.validation(config)) {
-            update_mind_recipe(config.recipes[config.recipe_init], microbe_child);
-            microbe_n = std::move(microbe_child);
+          uint64_t values[] = {ind, cells.family[ind], uint16_t(cells.age[ind]),
+              cells.direction[ind], uint8_t(cells.energy_remaining[ind])};
+          for (size_t res{}; res < cells.resources_count; ++res) {
+            resources[res] = cells.resources_microbe[res * count + ind];
           }
+          const auto& code = cells.genome[ind]->code;
+          auto        regs = cells.arena.regs(cells.slot[ind]);
+          h = utils_t::fasthash64(values, sizeof(values), h);
+          h = utils_t::fasthash64(resources.data(), resources.size() * sizeof(res_val_t), h);
+          h = utils_t::fasthash64(code.data(), code.size(), h);
+          h = utils_t::fasthash64(regs.data(), regs.size(), h);
         }
-        break;
+      }
+      cells.tiles_hash[tile] = h;
+    };
+
+    // a pool exists once a tiled tick ran
+    if (pool && tiles.size() > 1) {
+      pool->run(tiles.size(), hash_tile);
+    } else {
+      for (size_t task{}; task < tiles.size(); ++task) {
+        hash_tile(task);
+      }
+    }
 
-      } case 20: {
-        uint8_t reg = SAFE_INDEX(code, rip++);
-        uint8_t ind = SAFE_INDEX(regs, reg);
+    uint64_t h = seed;
+    h = utils_t::fasthash64(cells.tiles_hash.data(), cells.tiles_hash.size() * sizeof(uint64_t), h);
+    h = utils_t::fasthash64(&stats.age, sizeof(stats.age), h);
+    h = utils_t::fasthash64(&stats.microbes_count, sizeof(stats.microbes_count), h);
 
-        LOG_GENESIS(MIND, "RECIPE <%zd>=%zd", reg, ind);
+    return h;
+  }
 
-        const auto& recipe = config.recipes[ind % config.recipes.size()];
-        if (recipe.available) {
-          update_mind_recipe(recipe, microbe);
+  // Random microbes, drawn from the seed, on the given share of the cells, the worlds of the
+  // benchmarks and the checks; regs_fill, when set, replaces every register, and so every
+  // opcode, with the same byte, energy the energy of every microbe. A radius keeps them in
+  // a square of that radius around the centre of the world, a cluster.
+  void world_t::fill_random(double occupancy, int regs_fill, res_val_t energy, size_t radius) {
+    TRACE_GENESIS;
+
+    for (size_t ind{}; ind < cells.size(); ++ind) {
+      rand_t rand(seed, 0, ind);
+      if (rand() % 1000000 >= occupancy * 1000000 || cells.alive[ind]) {
+        continue;
+      }
+      if (radius) {
+        auto [x, y] = xy_pos_from_ind(ind);
+        if (x + radius < config.x_max / 2 || x > config.x_max / 2 + radius
+            || y + radius < config.y_max / 2 || y > config.y_max / 2 + radius)
+        {
+          continue;
         }
-        break;
+      }
+      microbe_t microbe;
+      microbe.init(config, rand);
+      microbe.pos = xy_pos_from_ind(ind);
+      if (!microbe.validation(config, rand)) {
+        continue;
+      }
+      update_mind_recipe(config.recipes[config.recipe_init], microbe);
+      if (regs_fill >= 0) {
+        std::fill(microbe.regs.begin(), microbe.regs.end(), regs_fill);
+      }
+      if (energy) {
+        microbe.resources[utils_t::RES_ENERGY] = energy;
+      }
+      cells.load_microbe(ind, microbe);
+    }
+  }
 
-      } case 21: {
-        uint8_t reg1 = SAFE_INDEX(code, rip++);
-        uint8_t reg2 = SAFE_INDEX(code, rip++);
+  ////////////////////////////////////////////////////////////////////////////////
 
-        uint8_t  dir = SAFE_INDEX(regs, reg1);
-        uint16_t strength;
-        utils_t::load_data(strength, regs, reg2);
+  bool replay_log_t::open(world_t& world) {
+    TRACE_GENESIS;
 
-        LOG_GENESIS(MIND, "ATTACK <%d>=%zd <%d>=%zd", reg1, dir, reg2, strength);
+    dir_name = dir(world.world_file_name);
+    std::error_code ec;
+    std::filesystem::create_directories(dir_name, ec);
+    if (!ec) {
+      log.open(dir_name + "/" + LOG_FILE, std::ios::app);
+    }
+    if (ec || !log) {
+      LOG_GENESIS(ERROR, "can not open replay log %s", dir_name.c_str());
+      return false;
+    }
+    opened = true;
+    keyframes.clear();
 
-        auto stack_size = config.resources[utils_t::RES_ENERGY].stack_size;
-        strength %= stack_size;
+    return record(world, utils_t::REPLAY_START);
+  }
 
-        auto pos_n = pos_next(microbe.pos, dir);
-        uint64_t ind = xy_pos_to_ind(pos_n);
+  // The entry and the snapshot of the world as it is now. Only the copy happens here, the
+  // writer saves the snapshot, then appends the entry, flushed, so a crash keeps the log up
+  // to the last whole entry with its snapshot, then drops the keyframes thinned out. A write
+  // that fails is the log's own, the checkpoint chain of the world is not touched by it.
+  bool replay_log_t::record(world_t& world, size_t event) {
+    TRACE_GENESIS;
 
-        auto& microbe_attacked = cells[ind].microbe;
-        auto& energy           = microbe.resources[utils_t::RES_ENERGY];
-        auto& energy_attacked  = microbe_attacked.resources[utils_t::RES_ENERGY];
+    if (!opened) {
+      return false;
+    }
 
-        if (microbe.pos != pos_n
-            && energy > strength
-            && microbe_attacked.alive)
-        {
-          energy -= strength;
-          energy_attacked -= strength;
+    std::string snapshot = utils_t::replay_events.at(event) + "_" + std::to_string(world.stats.age) + ".snapshot";
+    auto data = std::make_shared<std::vector<uint8_t>>();
+    world_snapshot_wrapper_t(world).save(*data);
 
-          utils_t::normalize(energy, 0, stack_size);
-          utils_t::normalize(energy_attacked, 0, stack_size);
+    nlohmann::json entry;
+    entry["event"] = utils_t::replay_events.at(event);
+    entry["age"]   = world.stats.age;
+    if (event == utils_t::REPLAY_START) {
+      entry["seed"] = world.seed;
+    }
+    if (event != utils_t::REPLAY_KEYFRAME) {
+      config_json_wrapper_t(world.config).save(entry["config"]);
+      entry["config_hash"] = config_json_wrapper_t(world.config).hash();
+    }
+    entry["snapshot"] = snapshot;
+    entry["hash"]     = world.hash();
+
+    std::set<std::string> thinned;
+    if (event == utils_t::REPLAY_KEYFRAME) {
+      keyframes.push_back(world.stats.age);
+      thinned = thin(world.config.replay_keyframe_ticks, world.config.replay_keyframes);
+    }
+
+    world.save_start([this, data, entry = entry.dump(), snapshot, thinned = std::move(thinned)] {
+      if (!utils_t::save_file(dir_name + "/" + snapshot, *data)) {
+        LOG_GENESIS(ERROR, "can not save replay keyframe %s", snapshot.c_str());
+      } else {
+        log << entry << std::endl;
+        if (!log) {
+          LOG_GENESIS(ERROR, "can not write replay log %s", dir_name.c_str());
         }
-        break;
+      }
+      if (!thinned.empty()) {
+        prune(thinned);
+      }
+      return true;
+    });
 
-      } case 22: {
-        uint8_t reg1 = SAFE_INDEX(code, rip++);
-        uint8_t reg2 = SAFE_INDEX(code, rip++);
-        uint8_t reg3 = SAFE_INDEX(code, rip++);
+    return true;
+  }
 
-        uint8_t dir = SAFE_INDEX(regs, reg1);
-        uint8_t res = SAFE_INDEX(regs, reg2);
-        res_val_t val;
-        utils_t::load_data(val, regs, reg3);
+  // after a tick, a keyframe when one is due
+  void replay_log_t::update(world_t& world) {
+    TRACE_GENESIS;
 
-        LOG_GENESIS(MIND, "RESOURCE EXCHANGE <%zd>=%zd <%zd>=%zd <%zd>=%zd",
-            reg1, dir, reg2, res, reg3, val);
+    size_t keyframe_ticks = world.config.replay_keyframe_ticks;
+    if (opened && keyframe_ticks && world.stats.age % keyframe_ticks == 0) {
+      record(world, utils_t::REPLAY_KEYFRAME);
+    }
+  }
 
-        size_t resource         = res % config.resources.size();
-        auto   pos_n            = pos_next(microbe.pos, dir);
-        size_t ind              = xy_pos_to_ind(pos_n);
-        auto   stack_size       = config.resources[resource].stack_size;
-        auto&  microbe_resource = microbe.resources[resource];
-        auto&  cell_resource    = cells[ind].resources[resource];
-
-        if (microbe_resource + val >= 0
-            && microbe_resource + val <= stack_size
-            && cell_resource - val >= 0
-            && cell_resource - val <= stack_size)
-        {
-          microbe_resource += val;
-          cell_resource -= val;
-        }
+  // The snapshots of the keyframes that go, taken out of keyframes. The keyframe n, counted
+  // in keyframe_ticks, d of them before the last, stays while n is a multiple of 2^level,
+  // level the times keep fits in d doubling; the spacing of a keyframe only ever grows, the
+  // ones it keeps are always on disk.
+  std::set<std::string> replay_log_t::thin(uint64_t keyframe_ticks, size_t keep) {
+    TRACE_GENESIS;
 
-        break;
+    std::set<std::string> thinned;
+    if (!keep || keyframes.empty()) {
+      return thinned;
+    }
 
-      } default: {
-        LOG_GENESIS(MIND, "NOTHING");
-        break;
+    uint64_t last = keyframes.back() / keyframe_ticks;
+    std::erase_if(keyframes, [&](uint64_t age) {
+      uint64_t n = age / keyframe_ticks;
+      uint64_t d = last - std::min(n, last);
+      size_t level{};
+      while (level < 63 && d >= keep * ((uint64_t(2) << level) - 1)) {
+        ++level;
       }
-    }
+      if (n % (uint64_t(1) << level) == 0) {
+        return false;
+      }
+      thinned.insert(utils_t::replay_events[utils_t::REPLAY_KEYFRAME] + "_" + std::to_string(age) + ".snapshot");
+      return true;
+    });
 
-    SAFE_INDEX(regs, utils_t::REG_RIP1B) = rip;
+    return thinned;
   }
 
-  bool world_t::update_mind_recipe(const recipe_t& recipe, microbe_t& microbe) {
-    auto& resources = microbe.resources;
+  // On the writer: the log without the entries of the snapshots, renamed over the old one so
+  // it never refers to a missing snapshot, then the snapshots.
+  bool replay_log_t::prune(const std::set<std::string>& snapshots) {
+    TRACE_GENESIS;
 
-    for (const auto& [ind, count] : recipe.in_out) {
-      const auto& resource_info = config.resources[ind];
-      auto count_n = resources[ind] + count;
-      if (count_n < 0 || count_n > resource_info.stack_size) {
-        return false;
+    std::string file_name = dir_name + "/" + LOG_FILE;
+    std::ifstream file(file_name);
+    std::ofstream file_new(file_name + ".tmp", std::ios::trunc);
+    for (std::string line; std::getline(file, line);) {
+      auto entry = nlohmann::json::parse(line, nullptr, false);
+      bool thinned = entry.is_object() && entry.value("event", "") == utils_t::replay_events[utils_t::REPLAY_KEYFRAME]
+          && snapshots.count(entry.value("snapshot", ""));
+      if (!thinned) {
+        file_new << line << '\n';
       }
     }
+    file_new.flush();
 
-    for (const auto& [ind, count] : recipe.in_out) {
-      const auto& resource_info = config.resources[ind];
-      auto count_n = count;
+    if (!file.eof() || !file_new || !utils_t::rename(file_name + ".tmp", file_name)) {
+      LOG_GENESIS(ERROR, "can not prune replay log %s", dir_name.c_str());
+      return false;
+    }
+    log.close();
+    log.open(file_name, std::ios::app);
 
-      auto& resource = resources[ind];
-      resource += count_n;
-      utils_t::normalize(resource, 0, resource_info.stack_size);
-      LOG_GENESIS(MIND, "resource %zd", resource);
+    for (const auto& snapshot : snapshots) {
+      utils_t::remove(dir_name + "/" + snapshot);
+    }
+    return true;
+  }
+
+  // the entries in the order they were written; a last line cut by a crash is left out
+  bool replay_log_t::load(const std::string& dir_name, entries_t& entries) {
+    TRACE_GENESIS;
+
+    std::ifstream file(dir_name + "/" + LOG_FILE);
+    if (!file) {
+      LOG_GENESIS(ERROR, "can not open replay log %s", dir_name.c_str());
+      return false;
+    }
+
+    for (std::string line; std::getline(file, line);) {
+      auto entry = nlohmann::json::parse(line, nullptr, false);
+      if (entry.is_discarded() || !entry.is_object() || !entry.contains("age") || !entry.contains("snapshot")) {
+        LOG_GENESIS(ERROR, "invalid replay entry %zd", entries.size());
+        continue;
+      }
+      entries.push_back(std::move(entry));
     }
 
     return true;
   }
 
-  void world_t::init() {
+  // The world as it was at age: the last keyframe at or before age of the run that was
+  // live then, checked against its hash, and the ticks from there. The config and the seed
+  // are of the log, the file names of the world are left as they are.
+  bool replay_log_t::seek(const std::string& dir_name, uint64_t age, world_t& world) {
     TRACE_GENESIS;
 
-    load_config();
-    load_data();
+    entries_t entries;
+    if (!load(dir_name, entries)) {
+      return false;
+    }
 
-    utils_t::seed = config.seed ? config.seed : time(0);
-    utils_t::debug = config.debug;
+    auto is = [](const nlohmann::json& entry, size_t event) {
+      return entry.value("event", "") == utils_t::replay_events[event];
+    };
 
-    save_config();
-    // save_data();
+    size_t start = utils_t::npos;
+    for (size_t ind{}; ind < entries.size(); ++ind) {
+      if (is(entries[ind], utils_t::REPLAY_START) && entries[ind].value("age", uint64_t{}) <= age) {
+        start = ind;
+      }
+    }
+    if (start == utils_t::npos) {
+      LOG_GENESIS(ERROR, "no run of the replay log %s starts by %zd", dir_name.c_str(), age);
+      return false;
+    }
+
+    size_t keyframe = start;
+    size_t config   = start;
+    for (size_t ind = start + 1; ind < entries.size() && !is(entries[ind], utils_t::REPLAY_START); ++ind) {
+      if (entries[ind].value("age", uint64_t{}) > age) {
+        break;
+      }
+      keyframe = ind;
+      if (is(entries[ind], utils_t::REPLAY_CONFIG)) {
+        config = ind;
+      }
+    }
+
+    const auto& entry = entries[keyframe];
+    if (!config_json_wrapper_t(world.config).load(entries[config]["config"])) {
+      LOG_GENESIS(ERROR, "invalid replay config at %zd", entries[config].value("age", size_t{}));
+      return false;
+    }
+    world.seed = entries[start].value("seed", uint64_t{});
+
+    std::string snapshot = dir_name + "/" + entry["snapshot"].get<std::string>();
+    if (!world_snapshot_wrapper_t(world).load(snapshot)) {
+      LOG_GENESIS(ERROR, "can not load replay keyframe %s", snapshot.c_str());
+      return false;
+    }
+    if (world.hash() != entry.value("hash", uint64_t{})) {
+      LOG_GENESIS(ERROR, "replay keyframe %s does not match its hash", snapshot.c_str());
+      return false;
+    }
+
+    while (world.stats.age < age) {
+      world.update_world();
+    }
+
+    return true;
   }
 
   void world_t::load_config() {
@@ -1282,21 +4325,280 @@ namespace genesis_n {
   void world_t::load_data() {
     TRACE_GENESIS;
 
-    if (!world_json_wrapper_t(*this).load(world_file_name)) {
+    snapshot_header_t header;
+    if (world_snapshot_wrapper_t::load_header(world_file_name, header)
+        && (header.x_max != config.x_max
+            || header.y_max != config.y_max
+            || header.resources_count != config.resources.size()
+            || header.code_size != config.code_size
+            || header.regs_size != config.regs_size))
+    {
+      load_resized(header);
+      return;
+    }
+
+    bool base = std::filesystem::exists(world_file_name);
+    bool loaded = world_snapshot_wrapper_t::is_snapshot(world_file_name)
+        ? world_snapshot_wrapper_t(*this).load(world_file_name)
+        : world_json_wrapper_t(*this).load(world_file_name);
+
+    if (!loaded) {
       LOG_GENESIS(ERROR, "can not load world");
       throw std::runtime_error("can not load world");
     }
+
+    // replay the delta checkpoints written after the full save, the chain ends at the first
+    // missing delta or at one that belongs to an older full save
+    save_wait();
+    checkpoint_pending  = false;
+    save_failed         = false;
+    checkpoint_base     = base;
+    checkpoint_base_age = stats.age;
+    checkpoint_sequence = 0;
+    while (base) {
+      auto file_name = world_snapshot_wrapper_t::delta_file_name(world_file_name, checkpoint_sequence + 1);
+      if (!std::filesystem::exists(file_name)
+          || !world_snapshot_wrapper_t(*this).load_delta(file_name, checkpoint_base_age, checkpoint_sequence + 1))
+      {
+        break;
+      }
+      checkpoint_sequence++;
+    }
+    cells.clear_dirty();
+  }
+
+  // The config changed the dimensions of the saved world: the world is loaded as it was saved,
+  // its deltas replayed, then its cells are placed at the same x, y of a world of the config.
+  // The microbes go through microbe_t::validation as those of a json world do.
+  void world_t::load_resized(const snapshot_header_t& header) {
+    TRACE_GENESIS;
+
+    world_t saved;
+    saved.seed                  = seed;
+    saved.world_file_name       = world_file_name;
+    saved.config                = config;
+    saved.config.x_max          = header.x_max;
+    saved.config.y_max          = header.y_max;
+    saved.config.code_size      = header.code_size;
+    saved.config.regs_size      = header.regs_size;
+    saved.config.resources.resize(header.resources_count);
+    for (auto& recipe : saved.config.recipes) {
+      std::erase_if(recipe.in_out, [&](const auto& in_out) { return in_out.first >= header.resources_count; });
+    }
+    saved.load_data();
+
+    LOG_GENESIS(ERROR, "world saved as %zdx%zd, resized to %zdx%zd", saved.config.x_max, saved.config.y_max,
+        config.x_max, config.y_max);
+
+    stats = saved.stats;
+    cells.init(config);
+
+    size_t count           = cells.size();
+    size_t count_saved     = saved.cells.size();
+    size_t resources_count = std::min(cells.resources_count, saved.cells.resources_count);
+    for (size_t y{}; y < std::min(config.y_max, saved.config.y_max); ++y) {
+      for (size_t x{}; x < std::min(config.x_max, saved.config.x_max); ++x) {
+        size_t ind       = x + y * config.x_max;
+        size_t ind_saved = x + y * saved.config.x_max;
+        for (size_t res{}; res < resources_count; ++res) {
+          auto resource = saved.cells.resources_cell[res * count_saved + ind_saved];
+          utils_t::normalize(resource, 0, config.resources[res].stack_size);
+          cells.resources_cell[res * count + ind] = resource;
+        }
+
+        if (!saved.cells.alive[ind_saved]) {
+          continue;
+        }
+        microbe_t microbe;
+        saved.cells.save_microbe(ind_saved, microbe);
+        microbe.pos = {x, y};
+        rand_t rand(seed, stats.age, utils_t::RAND_LOAD + ind);
+        if (microbe.validation(config, rand)) {
+          cells.load_microbe(ind, microbe);
+        }
+      }
+    }
+
+    // the saved world does not fit the config, the next save is a full one
+    checkpoint_base     = false;
+    checkpoint_base_age = stats.age;
+    checkpoint_sequence = 0;
+    cells.clear_dirty();
   }
 
   void world_t::save_data() {
     TRACE_GENESIS;
 
+    save_wait();
+    save_commit();
+
 #ifndef VALGRIND
-    if (!world_json_wrapper_t(*this).save(world_file_name)) {
+    bool saved = config.world_format == utils_t::WORLD_SNAPSHOT
+        ? world_snapshot_wrapper_t(*this).save(world_file_name)
+        : world_json_wrapper_t(*this).save(world_file_name);
+
+    if (!saved) {
       LOG_GENESIS(ERROR, "can not save world");
       throw std::runtime_error("can not save world");
     }
+    world_snapshot_wrapper_t::remove_deltas(world_file_name);
+
+    checkpoint_base     = true;
+    checkpoint_base_age = stats.age;
+    checkpoint_sequence = 0;
+    cells.clear_dirty();
+#endif
+  }
+
+  // Only the copy of the world happens on the simulation thread: the snapshot bytes, or the
+  // cells for JSON. Building the JSON tree, writing and fsync run on the writer thread.
+  // Returns false without saving while the previous save is still being written.
+  bool world_t::save_data_async() {
+    TRACE_GENESIS;
+
+    if (save_busy) {
+      return false;
+    }
+    save_commit();
+
+#ifndef VALGRIND
+    auto time_beg = std::chrono::steady_clock::now();
+
+    checkpoint_pending  = true;
+    checkpoint_next_age = stats.age;
+    checkpoint_next_seq = 0;
+    cells.clear_dirty();
+
+    std::function<bool()> write;
+    if (config.world_format == utils_t::WORLD_SNAPSHOT) {
+      auto data = std::make_shared<std::vector<uint8_t>>();
+      world_snapshot_wrapper_t(*this).save(*data);
+      write = [data, file_name = world_file_name] {
+        return utils_t::save_file(file_name, *data);
+      };
+    } else {
+      auto cells = std::make_shared<world_json_wrapper_t::cells_t>();
+      world_json_wrapper_t(*this).copy(*cells);
+      write = [cells, file_name = world_file_name, stats = stats, binary = config.binary_data] {
+        return world_json_wrapper_t::save(file_name, *cells, stats, binary);
+      };
+    }
+
+    // the deltas of the previous chain go once the new full save is in place
+    save_start([write = std::move(write), file_name = world_file_name] {
+      if (!write()) {
+        return false;
+      }
+      world_snapshot_wrapper_t::remove_deltas(file_name);
+      return true;
+    });
+
+    auto time_end = std::chrono::steady_clock::now();
+    stats.time_save_stall = std::chrono::duration_cast<std::chrono::microseconds>(time_end - time_beg).count();
+#endif
+
+    return true;
+  }
+
+  // Writes the tiles changed since the previous checkpoint as the next delta of the chain.
+  // Returns false while the previous save is being written. Without a full save on disk
+  // to apply to, the chain of a new world or one whose write failed, it is a full save.
+  bool world_t::save_delta_async() {
+    TRACE_GENESIS;
+
+    if (save_busy) {
+      return false;
+    }
+    save_commit();
+    if (!checkpoint_base) {
+      return save_data_async();
+    }
+
+#ifndef VALGRIND
+    auto time_beg = std::chrono::steady_clock::now();
+
+    checkpoint_pending  = true;
+    checkpoint_next_age = checkpoint_base_age;
+    checkpoint_next_seq = checkpoint_sequence + 1;
+
+    auto data = std::make_shared<std::vector<uint8_t>>();
+    world_snapshot_wrapper_t(*this).save_delta(*data, checkpoint_next_age, checkpoint_next_seq);
+    cells.clear_dirty();
+
+    save_start([data, file_name = world_snapshot_wrapper_t::delta_file_name(world_file_name, checkpoint_next_seq)] {
+      return utils_t::save_file(file_name, *data);
+    });
+
+    auto time_end = std::chrono::steady_clock::now();
+    stats.time_save_stall = std::chrono::duration_cast<std::chrono::microseconds>(time_end - time_beg).count();
 #endif
+
+    return true;
+  }
+
+  void world_t::save_start(std::function<bool()> write) {
+    TRACE_GENESIS;
+
+    save_wait();
+    save_busy = true;
+
+    save_thread = std::thread([this, write = std::move(write)] {
+      auto time_beg = std::chrono::steady_clock::now();
+      if (!write()) {
+        LOG_GENESIS(ERROR, "can not save world");
+        save_failed = true;
+      }
+      auto time_end = std::chrono::steady_clock::now();
+      save_write = std::chrono::duration_cast<std::chrono::microseconds>(time_end - time_beg).count();
+      save_busy  = false;
+    });
+  }
+
+  void world_t::save_wait() {
+    TRACE_GENESIS;
+
+    if (save_thread.joinable()) {
+      save_thread.join();
+    }
+  }
+
+  // The chain of the last write is taken once the writer is done with it. A failed write left
+  // the chain on disk as it was while the dirty tiles were cleared for it: every tile goes in
+  // the next checkpoint, and that is a full save.
+  void world_t::save_commit() {
+    TRACE_GENESIS;
+
+    if (!checkpoint_pending || save_busy) {
+      return;
+    }
+    save_wait();
+    checkpoint_pending = false;
+
+    if (save_failed.exchange(false)) {
+      checkpoint_base = false;
+      cells.mark_dirty_all();
+      return;
+    }
+    checkpoint_base     = true;
+    checkpoint_base_age = checkpoint_next_age;
+    checkpoint_sequence = checkpoint_next_seq;
+  }
+
+  // The trace rings of every thread, as Chrome trace JSON next to the world file; nothing
+  // is written unless the config enables trace categories in a non-production build.
+  bool world_t::save_trace() {
+    TRACE_GENESIS;
+
+    auto file_name = world_file_name + ".trace.json";
+    if (!trace_n::dump(file_name, utils_t::categories)) {
+      LOG_GENESIS(ERROR, "can not write trace %s", file_name.c_str());
+      return false;
+    }
+    return true;
+  }
+
+  world_t::~world_t() {
+    save_wait();
   }
 
   ////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,470 @@
+
+#include <iostream>
+#include <numeric>
+#include <sys/resource.h>
+#include "genesis.h"
+
+// every allocation of the process is counted, the scenarios report the ones made while ticking
+static std::atomic<uint64_t> allocations_count = {};
+static std::atomic<uint64_t> allocations_bytes = {};
+
+// not inlined, so the compiler does not pair malloc and free with the callers' new and delete
+[[gnu::noinline]] void* operator new(size_t size) {
+  allocations_count.fetch_add(1, std::memory_order_relaxed);
+  allocations_bytes.fetch_add(size, std::memory_order_relaxed);
+  if (void* ptr = std::malloc(size ? size : 1)) {
+    return ptr;
+  }
+  throw std::bad_alloc();
+}
+
+[[gnu::noinline]] void operator delete(void* ptr) noexcept {
+  std::free(ptr);
+}
+
+[[gnu::noinline]] void operator delete(void* ptr, size_t) noexcept {
+  std::free(ptr);
+}
+
+// VmHWM of the process; writing 5 to clear_refs resets it, so every scenario gets its own peak
+static uint64_t peak_rss_kb(bool reset) {
+  if (reset) {
+    std::ofstream("/proc/self/clear_refs") << "5";
+    return 0;
+  }
+
+  std::ifstream status("/proc/self/status");
+  for (std::string line; std::getline(status, line);) {
+    if (line.starts_with("VmHWM:")) {
+      return std::stoul(line.substr(6));
+    }
+  }
+
+  struct rusage usage = {};
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_maxrss;
+}
+
+int main(int argc, char* argv[]) {
+
+  if (argc > 1 && (std::string(argv[1]) == "-h" || std::string(argv[1]) == "--help")) {
+    std::cerr << "usage: " << argv[0]
+        << " [config.json] [ticks] [threads] [scenario...]" << std::endl
+        << "scenarios: empty dense clone_heavy attack_heavy emission_only threads mind occupancy"
+        << " save_load checkpoint save_stall" << std::endl;
+    return -1;
+  }
+
+  std::string config_file_name = argc > 1 ? argv[1] : "json/benchmark_config.json";
+  size_t      ticks            = argc > 2 ? std::stoul(argv[2]) : 100;
+  size_t      threads          = argc > 3 ? std::stoul(argv[3]) : std::max(2U, std::thread::hardware_concurrency());
+
+  std::set<std::string> scenarios_selected(argv + std::min(argc, 4), argv + argc);
+
+  using namespace genesis_n;
+
+  constexpr uint64_t SEED = 0x5EED;
+
+  // the config is only read, the world is built in memory
+  config_t config_base;
+  if (!config_json_wrapper_t(config_base).load(config_file_name)) {
+    std::cerr << "can not load config " << config_file_name << std::endl;
+    return -1;
+  }
+  utils_t::set_debug(config_base.debug);
+
+  auto world_init = [&](world_t& world, bool emission) {
+    world.config = config_base;
+    world.seed   = SEED;
+    world.config.update_threads  = threads;
+    world.config.spawn_min_count = 0;
+    world.config.spawn_max_count = 0;
+    for (auto& resource : world.config.resources) {
+      resource.areas.resize(emission ? resource.areas.size() : 0);
+    }
+    world.cells.init(world.config);
+  };
+
+  auto run = [&](world_t& world) {
+    nlohmann::json result;
+
+    uint64_t instructions  = {};
+    uint64_t microbes_sum  = {};
+    uint64_t emission_us   = {};
+    uint64_t count_beg     = allocations_count;
+    uint64_t bytes_beg     = allocations_bytes;
+
+    auto time_beg = std::chrono::steady_clock::now();
+    for (size_t i{}; i < ticks; ++i) {
+      world.update_world();
+      instructions += world.stats.instructions;
+      microbes_sum += world.stats.microbes_count;
+      emission_us  += world.stats.time_emission;
+    }
+    auto time_end = std::chrono::steady_clock::now();
+
+    double time_s = std::chrono::duration<double>(time_end - time_beg).count();
+    const auto& phases = world.stats.phases;
+
+    result["ticks"]              = ticks;
+    result["time_s"]             = time_s;
+    result["ticks_per_s"]        = ticks / std::max(time_s, 1e-9);
+    result["instructions_per_s"] = instructions / std::max(time_s, 1e-9);
+    result["ns_per_microbe"]     = microbes_sum ? time_s * 1e9 / microbes_sum : 0.;
+    result["microbes_avg"]       = 1. * microbes_sum / std::max(size_t{1}, ticks);
+    result["microbes_end"]       = world.stats.microbes_count;
+    result["families_end"]       = world.cells.genomes.size();
+    result["emission_us_per_tick"] = 1. * emission_us / std::max(size_t{1}, ticks);
+    result["tick_p50_ms"]        = phases[utils_t::PHASE_TICK].p50 / 1e6;
+    result["tick_p99_ms"]        = phases[utils_t::PHASE_TICK].p99 / 1e6;
+    result["tick_max_ms"]        = phases[utils_t::PHASE_TICK].max / 1e6;
+    result["mind_p50_ms"]        = phases[utils_t::PHASE_MIND].p50 / 1e6;
+    result["mind_p99_ms"]        = phases[utils_t::PHASE_MIND].p99 / 1e6;
+    result["allocations"]        = allocations_count - count_beg;
+    result["allocated_bytes"]    = allocations_bytes - bytes_beg;
+    result["allocations_per_tick"] = 1. * (allocations_count - count_beg) / std::max(size_t{1}, ticks);
+    return result;
+  };
+
+  using scenario_t = std::function<nlohmann::json()>;
+
+  std::vector<std::pair<std::string, scenario_t>> scenarios = {
+    // the fixed cost of a tick: no microbes, no emission
+    {"empty", [&] {
+      world_t world;
+      world_init(world, false);
+      return run(world);
+    }},
+
+    // half of the cells hold random microbes, with emission
+    {"dense", [&] {
+      world_t world;
+      world_init(world, true);
+      world.fill_random(0.5, -1, 0);
+      return run(world);
+    }},
+
+    // every opcode is CLONE and a clone costs little energy, so the lineages grow every tick
+    // and the code mutations keep interning new genomes
+    {"clone_heavy", [&] {
+      world_t world;
+      world_init(world, false);
+      for (auto& [ind, count] : world.config.recipes[world.config.recipe_clone].in_out) {
+        count = std::max<res_val_t>(count, -10);
+      }
+      world.fill_random(0.01, 19, 0);
+      return run(world);
+    }},
+
+    // every opcode is ATTACK; the strength is read from the regs as 0x1515 and taken modulo the
+    // energy stack size, which is set so that it is 1 and the attacked live through the run
+    {"attack_heavy", [&] {
+      world_t world;
+      world_init(world, false);
+      world.config.resources[utils_t::RES_ENERGY].stack_size = 0x1515 - 1;
+      world.fill_random(0.5, 21, 0x1515 - 1);
+      return run(world);
+    }},
+
+    // an empty world, the tick is the resource emission; then every emission mode and kernel
+    // lookup in turn
+    {"emission_only", [&] {
+      world_t world;
+      world_init(world, true);
+      nlohmann::json result = run(world);
+      const auto& resources = world.cells.resources_cell;
+      result["resources_avg"] = std::accumulate(resources.begin(), resources.end(), 0.) / resources.size();
+
+      struct emission_run_t {
+        std::string   name;
+        bool          avx2;
+        size_t        emission;
+        bool          stochastic_rounding;
+      };
+
+      for (const auto& [name, avx2, emission, stochastic_rounding] : std::vector<emission_run_t>{
+          {"scalar",              false,  utils_t::EMISSION_RANDOM,    false},
+          {"avx2",                true,   utils_t::EMISSION_RANDOM,    false},
+          {"expected",            false,  utils_t::EMISSION_EXPECTED,  false},
+          {"expected_stochastic", false,  utils_t::EMISSION_EXPECTED,  true}})
+      {
+        if (avx2 && !emission_batch_t::avx2) {
+          continue;
+        }
+        bool avx2_prev = std::exchange(emission_batch_t::avx2, avx2);
+
+        world_t world;
+        world_init(world, true);
+        uint64_t draws = {};
+        for (auto& resource : world.config.resources) {
+          for (auto& area : resource.areas) {
+            area.emission            = emission;
+            area.stochastic_rounding = stochastic_rounding;
+            area.init_kernel();
+            draws += area.frequency * 3.14 * area.radius * area.radius;
+          }
+        }
+        nlohmann::json mode = run(world);
+        emission_batch_t::avx2 = avx2_prev;
+
+        const auto& resources = world.cells.resources_cell;
+        result[name] = {
+          {"draws_per_tick",       draws},
+          {"emission_us_per_tick", mode["emission_us_per_tick"]},
+          {"resources_avg",        std::accumulate(resources.begin(), resources.end(), 0.) / resources.size()},
+        };
+      }
+      return result;
+    }},
+
+    // the dense world ticked by the sequential path and by the tiled one on the threads; the
+    // tiled update visits the microbes by checkerboard colour, so the worlds are not compared
+    {"threads", [&] {
+      nlohmann::json result;
+      for (size_t update_threads : {size_t{0}, threads}) {
+        world_t world;
+        world_init(world, true);
+        world.config.update_threads = update_threads;
+        world.fill_random(0.5);
+        nlohmann::json step = run(world);
+        result["threads_" + std::to_string(update_threads)] = {
+          {"ticks_per_s",    step["ticks_per_s"]},
+          {"ns_per_microbe", step["ns_per_microbe"]},
+          {"tick_p99_ms",    step["tick_p99_ms"]},
+        };
+      }
+      result["speedup"] = result["threads_" + std::to_string(threads)]["ticks_per_s"].get<double>()
+          / std::max(result["threads_0"]["ticks_per_s"].get<double>(), 1e-9);
+      return result;
+    }},
+
+    // both interpreters on the dense world without emission and with a large energy budget,
+    // so the tick is dominated by the interpreter
+    {"mind", [&] {
+      nlohmann::json result;
+      for (size_t mind_backend : {utils_t::MIND_SWITCH, utils_t::MIND_THREADED}) {
+        world_t world;
+        world_init(world, false);
+        world.config.mind_backend     = mind_backend;
+        world.config.energy_remaining = 100;
+        world.fill_random(0.5);
+        result[utils_t::mind_backends[mind_backend]] = run(world);
+      }
+      return result;
+    }},
+
+    // ticks/s and ns per microbe as the world fills up, with emission
+    {"occupancy", [&] {
+      nlohmann::json result;
+      for (double occupancy : {0.001, 0.01, 0.1, 0.5}) {
+        world_t world;
+        world_init(world, true);
+        world.fill_random(occupancy);
+        nlohmann::json step = run(world);
+        result[nlohmann::json(occupancy).dump()] = {
+          {"ticks_per_s",    step["ticks_per_s"]},
+          {"ns_per_microbe", step["ns_per_microbe"]},
+          {"microbes_avg",   step["microbes_avg"]},
+        };
+      }
+      return result;
+    }},
+
+    // a dense world after the run is saved and loaded back in every format
+    {"save_load", [&] {
+      world_t world;
+      world_init(world, true);
+      world.fill_random(0.5, -1, 0);
+      nlohmann::json result = run(world);
+
+      for (size_t world_format : {utils_t::WORLD_JSON, utils_t::WORLD_SNAPSHOT}) {
+        const auto& name = utils_t::world_formats[world_format];
+        world.config.world_format = world_format;
+        world.world_file_name     = std::filesystem::temp_directory_path() / ("genesis_bench." + name);
+
+        auto time_beg = std::chrono::steady_clock::now();
+        world.save_data();
+        auto time_save = std::chrono::steady_clock::now();
+
+        world_t world_loaded;
+        world_init(world_loaded, true);
+        world_loaded.world_file_name = world.world_file_name;
+        world_loaded.load_data();
+        auto time_load = std::chrono::steady_clock::now();
+
+        double size_mb = std::filesystem::file_size(world.world_file_name) / 1e6;
+        double save_s  = std::chrono::duration<double>(time_save - time_beg).count();
+        double load_s  = std::chrono::duration<double>(time_load - time_save).count();
+        std::filesystem::remove(world.world_file_name);
+
+        result[name] = {
+          {"size_mb",       size_mb},
+          {"save_s",        save_s},
+          {"load_s",        load_s},
+          {"save_mb_per_s", size_mb / std::max(save_s, 1e-9)},
+          {"load_mb_per_s", size_mb / std::max(load_s, 1e-9)},
+          {"round_trip",    world_loaded.hash() == world.hash()},
+        };
+      }
+      return result;
+    }},
+
+    // a full save of the dense world half way, then a delta every tenth of the rest; emission
+    // touches most tiles every tick, without it only the rows with microbes change, and a
+    // cluster of microbes in the middle of the world leaves the tiles away from it clean
+    {"checkpoint", [&] {
+      nlohmann::json result;
+      struct checkpoint_run_t {
+        std::string   name;
+        bool          emission;
+        size_t        radius;
+      };
+
+      for (const auto& [name, emission, radius] : std::vector<checkpoint_run_t>{
+          {"emission", true, 0}, {"no_emission", false, 0}, {"cluster", false, config_base.x_max / 16}})
+      {
+        world_t world;
+        world_init(world, emission);
+        world.fill_random(0.5, -1, 0, radius);
+        world.config.world_format = utils_t::WORLD_SNAPSHOT;
+        world.world_file_name     = std::filesystem::temp_directory_path() / "genesis_bench.checkpoint";
+
+        size_t delta_interval = std::max(size_t{1}, ticks / 10);
+        size_t deltas         = {};
+        double deltas_mb      = {};
+        double dirty_sum      = {};
+        double rows_dirty_sum = {};
+        double delta_max_s    = {};
+        for (size_t i{}; i < ticks; ++i) {
+          world.update_world();
+          if (i == ticks / 2) {
+            world.save_data();
+          } else if (i > ticks / 2 && (i % delta_interval == 0 || i == ticks - 1)) {
+            dirty_sum += 1. * std::count_if(world.cells.tiles_dirty.begin(), world.cells.tiles_dirty.end(),
+                [](uint8_t dirty) { return dirty & cells_soa_t::DIRTY_CHECKPOINT; })
+                / world.cells.tiles_dirty.size();
+            rows_dirty_sum += 1. * std::count_if(world.cells.rows_dirty.begin(), world.cells.rows_dirty.end(),
+                [](uint8_t dirty) { return dirty & cells_soa_t::DIRTY_CHECKPOINT; })
+                / world.cells.rows_dirty.size();
+            auto time_beg = std::chrono::steady_clock::now();
+            world.save_delta_async();
+            auto time_end = std::chrono::steady_clock::now();
+            world.save_wait();
+            delta_max_s = std::max(delta_max_s, std::chrono::duration<double>(time_end - time_beg).count());
+            deltas_mb += std::filesystem::file_size(
+                world_snapshot_wrapper_t::delta_file_name(world.world_file_name, ++deltas)) / 1e6;
+          }
+        }
+
+        world_t world_loaded;
+        world_init(world_loaded, emission);
+        world_loaded.world_file_name = world.world_file_name;
+        world_loaded.load_data();
+
+        double base_mb = std::filesystem::file_size(world.world_file_name) / 1e6;
+        world_snapshot_wrapper_t::remove_deltas(world.world_file_name);
+        std::filesystem::remove(world.world_file_name);
+
+        result[name] = {
+          {"base_mb",           base_mb},
+          {"deltas",            deltas},
+          {"delta_avg_mb",      deltas_mb / std::max(size_t{1}, deltas)},
+          {"dirty_tiles_avg",   dirty_sum / std::max(size_t{1}, deltas)},
+          {"dirty_rows_avg",    rows_dirty_sum / std::max(size_t{1}, deltas)},
+          {"delta_call_max_ms", delta_max_s * 1e3},
+          {"round_trip",        world_loaded.checkpoint_sequence == deltas && world_loaded.hash() == world.hash()},
+        };
+      }
+      return result;
+    }},
+
+    // tick latency while saving: inline saves stall the tick for the whole write,
+    // background saves only for the copy of the world
+    {"save_stall", [&] {
+      nlohmann::json result;
+      for (size_t world_format : {utils_t::WORLD_JSON, utils_t::WORLD_SNAPSHOT}) {
+        for (bool async : {false, true}) {
+          world_t world;
+          world_init(world, true);
+          world.fill_random(0.5);
+          world.config.world_format = world_format;
+          world.world_file_name     = std::filesystem::temp_directory_path()
+              / ("genesis_bench." + utils_t::world_formats[world_format]);
+
+          size_t save_interval = std::max(size_t{1}, ticks / 3);
+          size_t saves         = {};
+          double tick_max_s    = {};
+          double save_max_s    = {};
+          for (size_t i{}; i < ticks; ++i) {
+            auto time_beg = std::chrono::steady_clock::now();
+            world.update_world();
+            auto time_save = std::chrono::steady_clock::now();
+            if (i % save_interval == save_interval - 1) {
+              if (!async) {
+                world.save_data();
+                saves++;
+              } else if (world.save_data_async()) {
+                saves++;
+              }
+            }
+            auto time_end = std::chrono::steady_clock::now();
+            tick_max_s = std::max(tick_max_s, std::chrono::duration<double>(time_end - time_beg).count());
+            save_max_s = std::max(save_max_s, std::chrono::duration<double>(time_end - time_save).count());
+          }
+          world.save_wait();
+          std::filesystem::remove(world.world_file_name);
+
+          result[utils_t::world_formats[world_format] + (async ? "_async" : "_inline")] = {
+            {"saves",            saves},
+            {"tick_max_ms",      tick_max_s * 1e3},
+            {"save_call_max_ms", save_max_s * 1e3},
+            {"save_write_ms",    async ? world.save_write / 1e3 : 0.},
+          };
+        }
+      }
+      return result;
+    }},
+  };
+
+  nlohmann::json report;
+  report["config"]       = config_file_name;
+  report["ticks"]        = ticks;
+  report["threads"]      = threads;
+  report["seed"]         = SEED;
+  report["mind_backend"] = utils_t::mind_backends[config_base.mind_backend];
+  report["avx2"]         = emission_batch_t::avx2;
+  report["scenarios"]    = nlohmann::json::array();
+
+  bool failed = false;
+  for (const auto& [name, scenario] : scenarios) {
+    if (!scenarios_selected.empty() && !scenarios_selected.contains(name)) {
+      continue;
+    }
+
+    peak_rss_kb(true);
+    nlohmann::json result = scenario();
+    result["scenario"]    = name;
+    result["peak_rss_kb"] = peak_rss_kb(false);
+    std::cerr << name;
+    if (result.contains("ticks_per_s")) {
+      std::cerr << "   ticks_per_s " << result["ticks_per_s"];
+    }
+    std::cerr << std::endl;
+
+    for (const auto& format : result) {
+      if (format.is_object() && !format.value("round_trip", true)) {
+        failed = true;
+      }
+    }
+    report["scenarios"].push_back(result);
+  }
+
+  std::cout << report.dump(2) << std::endl;
+
+  if (failed) {
+    std::cerr << "world file does not round-trip" << std::endl;
+    return 1;
+  }
+
+  return 0;
+}
@@ -1,12 +1,13 @@
 
 #include <iostream>
+#include <numeric>
 #include "genesis.h"
 
 int main(int argc, char* argv[]) {
 
   if (argc <= 2) {
     std::cerr << "usage: " << (argc > 0 ? argv[0] : "<program>")
-        << " <config.json> <world.json>" << std::endl;
+        << " <config.json> <world.json> [ticks] [threads]" << std::endl;
     return -1;
   }
 
@@ -25,15 +26,287 @@ int main(int argc, char* argv[]) {
     return -1;
   }
 
+  size_t ticks   = argc > 3 ? std::stoul(argv[3]) : 1000;
+  size_t threads = argc > 4 ? std::stoul(argv[4]) : std::max(2U, std::thread::hardware_concurrency());
+
   using namespace genesis_n;
 
-  world_t world;
-  world.config_file_name = config_file_name;
-  world.world_file_name = world_file_name;
-  world.init();
+  uint64_t seed = {};
+
+  auto world_init = [&](world_t& world) {
+    world.config_file_name = config_file_name;
+    world.world_file_name = world_file_name;
+    world.seed = seed;
+    world.init();
+    seed = world.seed;
+  };
+
+  // every executed instruction is counted under its opcode
+  bool opcodes_counted = true;
+
+  // the incremental tile hash is the one of hashing every tile
+  bool hash_tiles_match = true;
+
+  // age and hash_tiles every hash_log_ticks of the last run, to tell the first tick two runs differ at
+  using hashes_t = std::vector<std::pair<uint64_t, uint64_t>>;
+  hashes_t hashes_run;
+
+  // every run starts from the same world file and seed
+  auto run = [&](size_t update_threads, size_t mind_backend) {
+    world_t world;
+    world_init(world);
+    world.config.update_threads = update_threads;
+    world.config.mind_backend   = mind_backend;
+
+    hashes_run.clear();
+    for (size_t i{}; i < ticks; ++i) {
+      world.update_world();
+      if (world.config.hash_log_ticks && world.stats.age % world.config.hash_log_ticks == 0) {
+        hashes_run.push_back({world.stats.age, world.hash_tiles()});
+      }
+      const auto& opcodes = world.stats.opcodes;
+      opcodes_counted &= std::accumulate(opcodes.begin(), opcodes.end(), uint64_t{}) == world.stats.instructions;
+    }
+
+    uint64_t hash = world.hash();
+    uint64_t hash_tiles = world.hash_tiles();
+    hash_tiles_match &= hash_tiles == world.hash_tiles(true);
+
+    std::cout << "threads " << update_threads
+        << "   mind " << utils_t::mind_backends[mind_backend]
+        << "   ticks " << ticks
+        << "   microbes_count " << world.stats.microbes_count
+        << "   hash " << std::hex << hash << std::dec
+        << "   hash_tiles " << std::hex << hash_tiles << std::dec
+        << std::endl;
+
+    return hash;
+  };
+
+  // the first logged tick two runs differ at, where to bisect from
+  auto diverged = [](const hashes_t& hashes_a, const hashes_t& hashes_b) -> std::string {
+    for (size_t ind{}; ind < std::min(hashes_a.size(), hashes_b.size()); ++ind) {
+      if (hashes_a[ind].second != hashes_b[ind].second) {
+        return ", first at age " + std::to_string(hashes_a[ind].first);
+      }
+    }
+    return "";
+  };
+
+  // the sequential path first, then the tiled one with 1 and N threads and both interpreters;
+  // the tiled runs must end in the same world regardless of the thread count and the interpreter
+  run(0, utils_t::MIND_SWITCH);
+  uint64_t hash_1          = run(1, utils_t::MIND_SWITCH);
+  hashes_t hashes_1        = hashes_run;
+  uint64_t hash_n          = run(threads, utils_t::MIND_SWITCH);
+  hashes_t hashes_n        = hashes_run;
+  uint64_t hash_threaded   = run(threads, utils_t::MIND_THREADED);
+  hashes_t hashes_threaded = hashes_run;
+
+  if (hash_1 != hash_n) {
+    std::cerr << "tiled update is not deterministic: threads 1 and " << threads << " differ"
+        << diverged(hashes_1, hashes_n) << std::endl;
+    return 1;
+  }
+
+  if (hash_n != hash_threaded) {
+    std::cerr << "mind backends differ: switch and threaded" << diverged(hashes_n, hashes_threaded) << std::endl;
+    return 1;
+  }
+
+  if (!hash_tiles_match) {
+    std::cerr << "incremental hash_tiles differs from hashing every tile" << std::endl;
+    return 1;
+  }
+
+  if (!opcodes_counted) {
+    std::cerr << "opcode counters do not add up to the instructions" << std::endl;
+    return 1;
+  }
+
+  // emission: an empty world without spawning, so the tick is the emission. The AVX2 and
+  // the scalar kernel lookups must give the same world. The expected emission must give the
+  // same resources on average as the random one, within resources_tolerance.
+  {
+    double resources_tolerance = 0.05;
+
+    struct emission_run_t {
+      std::string   name;
+      bool          avx2;
+      size_t        emission;
+      bool          stochastic_rounding;
+    };
+
+    uint64_t hash_scalar          = {};
+    double   resources_avg_scalar = {};
+    for (const auto& [name, avx2, emission, stochastic_rounding] : std::vector<emission_run_t>{
+        {"scalar",              false,  utils_t::EMISSION_RANDOM,    false},
+        {"avx2",                true,   utils_t::EMISSION_RANDOM,    false},
+        {"expected",            false,  utils_t::EMISSION_EXPECTED,  false},
+        {"expected_stochastic", false,  utils_t::EMISSION_EXPECTED,  true}})
+    {
+      if (avx2 && !emission_batch_t::avx2) {
+        continue;
+      }
+      bool avx2_prev = std::exchange(emission_batch_t::avx2, avx2);
+
+      world_t world;
+      world_init(world);
+      world.config.spawn_min_count = 0;
+      world.config.spawn_max_count = 0;
+      world.cells.init(world.config);
+
+      for (auto& resource : world.config.resources) {
+        for (auto& area : resource.areas) {
+          area.emission            = emission;
+          area.stochastic_rounding = stochastic_rounding;
+          area.init_kernel();
+        }
+      }
+
+      for (size_t i{}; i < ticks; ++i) {
+        world.update_world();
+      }
+      emission_batch_t::avx2 = avx2_prev;
+
+      double resources_sum = std::accumulate(world.cells.resources_cell.begin(),
+          world.cells.resources_cell.end(), 0.);
+      double resources_avg = resources_sum / world.cells.resources_cell.size();
+
+      std::cout << "emission " << name
+          << "   resources_avg " << resources_avg
+          << "   hash " << std::hex << world.hash() << std::dec
+          << std::endl;
+
+      if (name == "scalar") {
+        hash_scalar          = world.hash();
+        resources_avg_scalar = resources_avg;
+      } else if (name == "avx2" && world.hash() != hash_scalar) {
+        std::cerr << "emission differs: scalar and avx2" << std::endl;
+        return 1;
+      } else if (emission == utils_t::EMISSION_EXPECTED
+          && std::abs(resources_avg - resources_avg_scalar) > resources_tolerance * resources_avg_scalar)
+      {
+        std::cerr << "emission differs: " << name << " resources_avg " << resources_avg
+            << ", scalar " << resources_avg_scalar << std::endl;
+        return 1;
+      }
+    }
+  }
+
+  // world files: the world after the run, with random microbes added so every cell kind is
+  // in it, is saved in every format and loaded back into a second world, which must end up
+  // identical. The timings are in genesis_bench save_load.
+  {
+    world_t world;
+    world_init(world);
+    world.config.update_threads = threads;
+    world.fill_random(0.1);
+    for (size_t i{}; i < ticks; ++i) {
+      world.update_world();
+    }
+
+    for (size_t world_format : {utils_t::WORLD_JSON, utils_t::WORLD_SNAPSHOT}) {
+      auto file_name = std::filesystem::temp_directory_path()
+          / ("genesis_world." + utils_t::world_formats[world_format]);
+      world.config.world_format = world_format;
+      world.world_file_name     = file_name;
+      world.save_data();
+
+      world_t world_loaded;
+      world_init(world_loaded);
+      world_loaded.world_file_name = file_name;
+      world_loaded.load_data();
+      std::filesystem::remove(file_name);
+
+      std::cout << "world_format " << utils_t::world_formats[world_format]
+          << "   microbes_count " << world.stats.microbes_count
+          << "   hash " << std::hex << world_loaded.hash() << std::dec
+          << std::endl;
+
+      if (world_loaded.hash() != world.hash()) {
+        std::cerr << "world file does not round-trip: " << utils_t::world_formats[world_format] << std::endl;
+        return 1;
+      }
+    }
+  }
+
+  // delta checkpoints: a full save half way, then a delta every few ticks; the full save
+  // and its deltas must load into the world the run ended with, with emission, which touches
+  // most tiles every tick, and without. A cluster of microbes without emission leaves the
+  // tiles away from it clean, a delta of it must skip them and be smaller than the full
+  // save. The sizes are in genesis_bench checkpoint.
+  struct checkpoint_run_t {
+    bool     emission;
+    size_t   radius;
+  };
+
+  for (const auto& [emission, radius] : std::vector<checkpoint_run_t>{{true, 0}, {false, 0}, {false, 20}}) {
+    world_t world;
+    world_init(world);
+    world.config.update_threads = threads;
+    for (auto& resource : world.config.resources) {
+      resource.areas.resize(emission ? resource.areas.size() : 0);
+    }
+    if (radius) {
+      world.config.spawn_min_count = 0;
+      world.config.spawn_max_count = 0;
+    }
+    world.fill_random(radius ? 0.5 : 0.1, -1, 0, radius);
+    world.config.world_format   = utils_t::WORLD_SNAPSHOT;
+    world.world_file_name       = std::filesystem::temp_directory_path() / "genesis_world.checkpoint";
+
+    size_t delta_interval = std::max(size_t{1}, ticks / 10);
+    size_t deltas         = {};
+    size_t clean_min      = world.cells.tiles_dirty.size();
+    size_t delta_max      = {};
+    for (size_t i{}; i < ticks; ++i) {
+      world.update_world();
+      if (i == ticks / 2) {
+        world.save_data();
+      } else if (i > ticks / 2 && (i % delta_interval == 0 || i == ticks - 1)) {
+        clean_min = std::min<size_t>(clean_min, std::count_if(world.cells.tiles_dirty.begin(),
+            world.cells.tiles_dirty.end(), [](uint8_t dirty) {
+              return !(dirty & cells_soa_t::DIRTY_CHECKPOINT);
+            }));
+        world.save_delta_async();
+        world.save_wait();
+        delta_max = std::max<size_t>(delta_max, std::filesystem::file_size(
+            world_snapshot_wrapper_t::delta_file_name(world.world_file_name, ++deltas)));
+      }
+    }
+    size_t base_size = std::filesystem::file_size(world.world_file_name);
+
+    world_t world_loaded;
+    world_init(world_loaded);
+    world_loaded.world_file_name = world.world_file_name;
+    world_loaded.load_data();
+
+    world_snapshot_wrapper_t::remove_deltas(world.world_file_name);
+    std::filesystem::remove(world.world_file_name);
+
+    std::cout << "checkpoint   emission " << emission
+        << "   radius " << radius
+        << "   deltas " << world_loaded.checkpoint_sequence << "/" << deltas
+        << "   clean_tiles_min " << clean_min
+        << "   delta_max/base " << 1. * delta_max / base_size
+        << "   hash " << std::hex << world_loaded.hash() << std::dec
+        << std::endl;
+
+    if (world_loaded.checkpoint_sequence != deltas || world_loaded.hash() != world.hash()) {
+      std::cerr << "delta checkpoints do not round-trip" << std::endl;
+      return 1;
+    }
+    if (radius && (!clean_min || delta_max >= base_size)) {
+      std::cerr << "delta checkpoints of a cluster save the whole world" << std::endl;
+      return 1;
+    }
+  }
 
-  for (size_t i{}; i < 1000; ++i) {
-    world.update();
+  // the events recorded when the config enables the trace categories, non-production builds
+  if (!trace_n::dump(world_file_name + ".trace.json", utils_t::categories)) {
+    std::cerr << "can not write trace " << world_file_name << ".trace.json" << std::endl;
+    return 1;
   }
 
   return 0;
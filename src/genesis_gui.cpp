@@ -4,7 +4,7 @@
 #include <atomic>
 #include <mutex>
 #include <deque>
-#include "genesis.h"
+#include "genesis_view.h"
 
 using namespace genesis_n;
 
@@ -22,6 +22,7 @@ struct genesis_sfml_t {
     uint32_t      color_area_available   = 0xD0D0D0FF;
     uint32_t      color_min              = 0x0000FFFF;
     uint32_t      color_max              = 0xFF0000FF;
+    size_t        render_threads         = 2;
   };
 
   enum mode_t : uint64_t {
@@ -33,112 +34,25 @@ struct genesis_sfml_t {
     MODE_COUNT,
   };
 
-  struct cell_t {
-    using resources_t   = std::vector<res_val_t>;
-
-    bool          alive;
-    uint64_t      family;
-    xy_pos_t      pos;
-    uint64_t      age;
-    resources_t   resources_microbe;
-    resources_t   resources_world;
-  };
-
-  struct world_ctx_t {
-    using cells_t = std::vector<cell_t>;
-
-    bool       valid = false;
-    config_t   config;
-    cells_t    cells;
-    stats_t    stats;
-  };
-
-  class world_safe_t {
-    world_t             _world;
-    world_ctx_t         _ctx;
-    std::timed_mutex    _mutex;
-    std::atomic<bool>   _need_data = false;
-    std::atomic<bool>   _need_update = false;
-    std::atomic<bool>   _pause = false;
-    std::atomic<bool>   _stop = false;
-
-   public:
-    void init(const std::string& config_file_name, const std::string& world_file_name) {
-      _world.config_file_name = config_file_name;
-      _world.world_file_name  = world_file_name;
-    }
-
-    void stop() {
-      _stop = true;
-    }
-
-    void pause() {
-      _pause = !_pause;
-    }
-
-    void need_update() {
-      _need_update = true;
-    }
-
-    void update() {
-      _world.init();
-      while (!_stop) {
-        if (_pause) {
-          std::this_thread::sleep_for(std::chrono::milliseconds(1));
-          continue;
-        }
-        _world.update();
-
-        if (_need_update) {
-          _world.save_data();
-          _world.load_config();
-          _world.load_data();
-          _need_update = false;
-        }
-
-        if (_need_data && _mutex.try_lock_for(std::chrono::milliseconds(1))) {
-          _ctx.config = _world.config;
-          _ctx.stats = _world.stats;
-          _ctx.cells.resize(_world.config.x_max * _world.config.y_max);
-          for (size_t ind{}; ind < _world.cells.size(); ++ind) {
-            const auto& cell    = _world.cells[ind];
-            const auto& microbe = cell.microbe;
-            auto&       cell_n  = _ctx.cells[ind];
-            cell_n.alive        = microbe.alive;
-            cell_n.family       = microbe.family;
-            cell_n.pos          = { ind % _world.config.x_max, ind / _world.config.y_max };
-            cell_n.age          = microbe.age;
-            cell_n.resources_microbe   = microbe.resources;
-            cell_n.resources_world     = cell.resources;
-          }
-          _ctx.valid = true;
-          _need_data = false;
-          _mutex.unlock();
-        }
-      }
-      _world.save_data();
-    }
-
-    void get_cells(world_ctx_t& ctx) {
-      if (!_need_data && _mutex.try_lock_for(std::chrono::milliseconds(1))) {
-        std::swap(_ctx, ctx);
-        _mutex.unlock();
-      }
-      _need_data = true;
-    }
-  };
-
-
-
   sfml_config_t       sfml_config      = {};
 
   std::thread         thread_world     = {};
 
   std::string         config_file_name;
   std::string         world_file_name;
-  world_ctx_t         ctx;
-  config_t            config;
-  world_safe_t        world;
+  std::string         socket_path;     // the world of a genesis_server, instead of the files
+  const frame_t*      frame            = {};
+  std::unique_ptr<world_source_t>   world;
+
+  // one texel per cell, coloured on the render pool and uploaded at once
+  using pixels_t  = std::vector<sf::Color>;
+  using palette_t = std::array<sf::Color, 0x100>;
+
+  pixels_t            pixels           = {};
+  palette_t           palette          = {}; // color_min to color_max
+  sf::Texture         texture;
+  sf::Sprite          sprite;
+  std::unique_ptr<thread_pool_t>   pool;
 
   bool                showing_help     = false;
   std::string         stats_text       = {};
@@ -167,13 +81,36 @@ struct genesis_sfml_t {
       throw std::runtime_error("can not load font");
     }
 
-    world.init(config_file_name, world_file_name);
+    {
+      auto c1 = sf::Color(sfml_config.color_min);
+      auto c2 = sf::Color(sfml_config.color_max);
+      for (size_t ind{}; ind < palette.size(); ++ind) {
+        double r = ind / 255.;
+        palette[ind] = sf::Color(
+            c1.r * (1 - r) + c2.r * r,
+            c1.g * (1 - r) + c2.g * r,
+            c1.b * (1 - r) + c2.b * r,
+            255);
+      }
+    }
+
+    pool = std::make_unique<thread_pool_t>(std::max<size_t>(1, sfml_config.render_threads));
+
+    if (socket_path.empty()) {
+      auto world_local = std::make_unique<world_local_t>();
+      world_local->init(config_file_name, world_file_name);
+      world = std::move(world_local);
+    } else {
+      auto world_remote = std::make_unique<world_remote_t>();
+      world_remote->init(socket_path);
+      world = std::move(world_remote);
+    }
 
-    thread_world = std::move(std::thread([this] { world.update(); }));
+    thread_world = std::move(std::thread([this] { world->update(); }));
   }
 
   void deinit() {
-    world.stop();
+    world->stop();
     thread_world.join();
   }
 
@@ -249,11 +186,19 @@ struct genesis_sfml_t {
               break;
 
             } case sf::Keyboard::U: {
-              world.need_update();
+              world->need_update();
+              break;
+
+            } case sf::Keyboard::S: {
+              world->need_save();
+              break;
+
+            } case sf::Keyboard::T: {
+              world->need_trace();
               break;
 
             } case sf::Keyboard::Space: {
-              world.pause();
+              world->pause();
               break;
 
             } case sf::Keyboard::H: {
@@ -283,53 +228,99 @@ struct genesis_sfml_t {
   }
 
   void get_data() {
-    world.get_cells(ctx);
+    size_t cell_ind = utils_t::npos;
+    if (frame && frame->valid) {
+      const auto& config = *frame->config;
+      int x = pos_mouse.x;
+      int y = pos_mouse.y;
+      if (x >= 0 && x < (int) config.x_max && y >= 0 && y < (int) config.y_max) {
+        cell_ind = x + config.x_max * y;
+      }
+    }
+
+    // the cells the view shows, in blocks of a power of two cells once several share a pixel
+    frame_request_t request = {.resource=mode_param, .cell_ind=cell_ind};
+    auto& viewport = request.viewport;
+    {
+      auto   center = view_world.getCenter();
+      auto   size   = view_world.getSize();
+      double cells_per_pixel = size.x / std::max(1U, window.getSize().x);
+      while (viewport.step * 2 <= cells_per_pixel && viewport.step < viewport_t::STEP_MAX) {
+        viewport.step *= 2;
+      }
+      viewport.x = std::max<double>(0, std::floor(center.x - size.x / 2));
+      viewport.y = std::max<double>(0, std::floor(center.y - size.y / 2));
+      viewport.w = std::max<double>(0, std::ceil(center.x + size.x / 2) - viewport.x);
+      viewport.h = std::max<double>(0, std::ceil(center.y + size.y / 2) - viewport.y);
+    }
 
-    if (!ctx.valid) {
+    frame = &world->get_frame(request);
+
+    if (!frame->valid) {
       return;
     }
 
     static std::string help_text =
       "\n Space - pause"
       "\n U - reload config"
+      "\n S - save now"
+      "\n T - write trace"
       "\n M - change mode"
       "\n P - change mode_param"
       "\n Q - quit";
 
-    const auto& config = ctx.config;
+    const auto& config = *frame->config;
 
     std::string mode_text{};
     switch (mode) {
       case MODE_NORMAL:   mode_text = "normal"; break;
       case MODE_AGE:      mode_text = "age"; break;
-      case MODE_AREA:     mode_text = "area "
-                              + config.resources[mode_param % config.resources.size()].name; break;
-      case MODE_RESOURCE: mode_text = "resource "
-                              + config.resources[mode_param % config.resources.size()].name; break;
+      case MODE_AREA:     mode_text = "area " + config.resources[frame->resource].name; break;
+      case MODE_RESOURCE: mode_text = "resource " + config.resources[frame->resource].name; break;
       case MODE_FAMILY:   mode_text = "family"; break;
       default:            mode_text = "unknown"; break;
     }
 
-    const auto& stats = ctx.stats;
+    const auto& stats = frame->stats;
     stats_text = std::string{}
       + " H - show help"
       + (showing_help ? help_text : "") + "\n"
+      + (frame->error.empty() ? "" : "\n " + frame->error + "\n")
       + "\n mode: " + mode_text
       + "\n age: " + std::to_string(stats.age)
       + "\n microbes_count: " + std::to_string(stats.microbes_count)
       + "\n microbes_age_avg: " + std::to_string((uint64_t) stats.microbes_age_avg)
       + "\n time_update: " + std::to_string(stats.time_update)
+      + "\n time_save_stall: " + std::to_string(stats.time_save_stall)
+      + "\n time_save_write: " + std::to_string(stats.time_save_write)
+      + "\n time_emission: " + std::to_string(stats.time_emission)
       + "\n bpms: " + std::to_string(uint64_t (stats.microbes_count / std::max(1UL, stats.time_update)))
+      + "\n deaths: " + std::to_string(stats.deaths)
+      + "\n ";
+
+    // us, p50 / p99 / max over the profiler window
+    for (size_t ind{}; ind < utils_t::PHASES_COUNT; ++ind) {
+      const auto& phase = stats.phases[ind];
+      stats_text += "\n phase " + utils_t::phases[ind] + ": "
+          + std::to_string(phase.p50 / 1000) + " / "
+          + std::to_string(phase.p99 / 1000) + " / "
+          + std::to_string(phase.max / 1000);
+    }
+    stats_text += "\n ";
+    for (size_t ind{}; ind < utils_t::OPCODES_COUNT; ++ind) {
+      if (stats.opcodes[ind]) {
+        stats_text += "\n op " + utils_t::opcodes[ind] + ": " + std::to_string(stats.opcodes[ind]);
+      }
+    }
+
+    stats_text += std::string{}
       + "\n "
       + "\n pos: " + std::to_string(int(pos_mouse.x)) + "\t" + std::to_string(int(pos_mouse.y))
       + "";
 
-    int x = pos_mouse.x;
-    int y = pos_mouse.y;
-
-    if (x >= 0 && x < (int) config.x_max && y >= 0 && y < (int) config.y_max) {
-      uint64_t ind = x + config.x_max * y;
-      const auto& cell = ctx.cells[ind];
+    // the frame holds the cell that was under the mouse when it was requested
+    if (frame->cell_ind != utils_t::npos && frame->cell_ind == cell_ind) {
+      const auto& cell = frame->cell;
       if (cell.alive) {
         stats_text += "\n family " + std::to_string(cell.family);
         stats_text += "\n age " + std::to_string(cell.age);
@@ -355,78 +346,95 @@ struct genesis_sfml_t {
     }
   }
 
-  void draw_data() {
-    if (!ctx.valid) {
+  // The colours of the mode in row bands, a palette lookup per frame cell, then one upload
+  // and one sprite over the viewport; cells the mode does not show keep color_area_available.
+  void draw_cells() {
+    const auto& config   = *frame->config;
+    const auto& cells    = frame->cells;
+    const auto& viewport = frame->viewport;
+    size_t      count    = cells.size();
+
+    if (!count) {
       return;
     }
 
-    window.clear(sf::Color(sfml_config.color_background));
-    window.setView(view_world);
+    if (texture.getSize().x != viewport.w || texture.getSize().y != viewport.h) {
+      pixels.resize(count);
+      texture.create(viewport.w, viewport.h);
+      sprite.setTexture(texture, true);
+    }
 
-    const auto& config = ctx.config;
+    const auto empty = sf::Color(sfml_config.color_area_available);
+    const auto color = sf::Color(sfml_config.color_min);
+
+    // value * scale >> 16 is value * 255 / max without a division per cell
+    auto scale = [](int max) {
+      return (255 << 16) / std::max(max, 1);
+    };
+    auto ratio = [&](int value, int scale) {
+      return palette[std::clamp<int64_t>(int64_t(value) * scale >> 16, 0, 255)];
+    };
+
+    int age_scale      = scale(config.age_max + config.age_max_delta);
+    int resource_scale = scale(config.resources[frame->resource].stack_size);
+
+    auto band = [&](auto&& cell_color) {
+      size_t tasks = pool->size() * 4;
+      pool->run(tasks, [&](size_t task) {
+        size_t end = count * (task + 1) / tasks;
+        for (size_t ind = count * task / tasks; ind < end; ++ind) {
+          pixels[ind] = cell_color(cells[ind]);
+        }
+      });
+    };
 
-    {
-      sf::RectangleShape rectangle;
-      rectangle.setSize(sf::Vector2f(config.x_max, config.y_max));
-      rectangle.setPosition(sf::Vector2f(0, 0));
-      rectangle.setFillColor(sf::Color(sfml_config.color_area_available));
-      window.draw(rectangle);
+    switch (mode) {
+      case MODE_AGE: {
+        band([&](const frame_cell_t& cell) {
+          return cell.count ? ratio(cell.age, age_scale) : empty;
+        });
+        break;
+
+      } case MODE_AREA: {
+        band([&](const frame_cell_t& cell) {
+          return cell.resource_world ? ratio(cell.resource_world, resource_scale) : empty;
+        });
+        break;
+
+      } case MODE_RESOURCE: {
+        band([&](const frame_cell_t& cell) {
+          return cell.count && cell.resource_microbe ? ratio(cell.resource_microbe, resource_scale) : empty;
+        });
+        break;
+
+      } case MODE_FAMILY: {
+        band([&](const frame_cell_t& cell) {
+          return cell.count ? sf::Color(cell.family, cell.family >> 8, cell.family >> 16, 255) : empty;
+        });
+        break;
+
+      } default: {
+        band([&](const frame_cell_t& cell) {
+          return cell.count ? color : empty;
+        });
+      }
     }
 
-    for (const auto& cell : ctx.cells) {
-      sf::Color color;
-      auto c1 = sf::Color(sfml_config.color_min);
-      auto c2 = sf::Color(sfml_config.color_max);
-      switch (mode) {
-        case MODE_AGE: {
-          if (!cell.alive) continue;
-          double r = 1. * cell.age / (config.age_max + config.age_max_delta);
-          color = sf::Color(
-              c1.r * (1 - r) + c2.r * r,
-              c1.g * (1 - r) + c2.g * r,
-              c1.b * (1 - r) + c2.b * r,
-              255);
-          break;
-
-        } case MODE_AREA: {
-          mode_param %= config.resources.size();
-          if (!cell.resources_world[mode_param]) continue;
-          double r = 1. * cell.resources_world[mode_param] / config.resources[mode_param].stack_size;
-          color = sf::Color(
-              c1.r * (1 - r) + c2.r * r,
-              c1.g * (1 - r) + c2.g * r,
-              c1.b * (1 - r) + c2.b * r,
-              255);
-          break;
+    texture.update(reinterpret_cast<const sf::Uint8*>(pixels.data()));
+    sprite.setPosition(viewport.x, viewport.y);
+    sprite.setScale(viewport.step, viewport.step);
+    window.draw(sprite);
+  }
 
-        } case MODE_RESOURCE: {
-          if (!cell.alive) continue;
-          mode_param %= config.resources.size();
-          if (!cell.resources_microbe[mode_param]) continue;
-          double r = 1. * cell.resources_microbe[mode_param] / config.resources[mode_param].stack_size;
-          color = sf::Color(
-              c1.r * (1 - r) + c2.r * r,
-              c1.g * (1 - r) + c2.g * r,
-              c1.b * (1 - r) + c2.b * r,
-              255);
-          break;
+  void draw_data() {
+    if (!frame || !frame->valid) {
+      return;
+    }
 
-        } case MODE_FAMILY: {
-          if (!cell.alive) continue;
-          color = sf::Color(cell.family, cell.family >> 8, cell.family >> 16, 255);
-          break;
+    window.clear(sf::Color(sfml_config.color_background));
+    window.setView(view_world);
 
-        } default: {
-          if (!cell.alive) continue;
-          color = sf::Color(sfml_config.color_min);
-        }
-      }
-      sf::RectangleShape rectangle;
-      rectangle.setSize(sf::Vector2f(1, 1));
-      rectangle.setPosition(sf::Vector2f(cell.pos.first, cell.pos.second));
-      rectangle.setFillColor(color);
-      window.draw(rectangle);
-    }
+    draw_cells();
 
     {
       window.setView(view_text);
@@ -450,10 +458,22 @@ int main(int argc, char* argv[]) {
 
   if (argc <= 2) {
     std::cerr << "usage: " << (argc > 0 ? argv[0] : "<program>")
-        << " <config.json> <world.json>" << std::endl;
+        << " <config.json> <world.json>" << std::endl
+        << "       " << (argc > 0 ? argv[0] : "<program>")
+        << " --connect <socket>" << std::endl;
     return -1;
   }
 
+  genesis_sfml_t context;
+
+  if (std::string(argv[1]) == "--connect") {
+    context.socket_path = argv[2];
+    context.init();
+    context.loop();
+    context.deinit();
+    return 0;
+  }
+
   std::error_code ec;
   std::string config_file_name = std::filesystem::absolute(argv[1], ec);
 
@@ -469,8 +489,6 @@ int main(int argc, char* argv[]) {
     return -1;
   }
 
-  genesis_sfml_t context;
-
   context.config_file_name = config_file_name;
   context.world_file_name  = world_file_name;
 
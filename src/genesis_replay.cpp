@@ -0,0 +1,104 @@
+
+#include <iostream>
+#include "genesis.h"
+
+using namespace genesis_n;
+
+// Re-simulates every run of the log from its start, checking the world against the hash of
+// each entry; the first mismatch is the keyframe interval the runs diverged in.
+static bool verify(const std::string& dir_name) {
+  replay_log_t::entries_t entries;
+  if (!replay_log_t::load(dir_name, entries)) {
+    return false;
+  }
+
+  bool ok = true;
+  for (size_t ind{}; ind < entries.size(); ++ind) {
+    const auto& entry = entries[ind];
+    if (entry.value("event", "") != utils_t::replay_events[utils_t::REPLAY_START]) {
+      continue;
+    }
+
+    uint64_t age = entry.value("age", uint64_t{});
+    world_t world;
+    if (!replay_log_t::seek(dir_name, age, world)) {
+      return false;
+    }
+    std::cout << "start   age " << age << "   seed " << world.seed << std::endl;
+
+    uint64_t age_prev = age;
+    for (++ind; ind < entries.size(); ++ind) {
+      const auto& entry = entries[ind];
+      if (entry.value("event", "") == utils_t::replay_events[utils_t::REPLAY_START]) {
+        --ind;
+        break;
+      }
+
+      uint64_t age = entry.value("age", uint64_t{});
+      while (world.stats.age < age) {
+        world.update_world();
+      }
+      bool match = world.hash() == entry.value("hash", uint64_t{});
+      std::cout << entry.value("event", "") << "   age " << age
+          << (match ? "   ok" : "   diverged after " + std::to_string(age_prev)) << std::endl;
+      ok &= match;
+
+      // the reloaded world goes on from the snapshot of the reload, as the run did
+      if (entry.value("event", "") == utils_t::replay_events[utils_t::REPLAY_CONFIG]
+          && !replay_log_t::seek(dir_name, age, world))
+      {
+        return false;
+      }
+      age_prev = age;
+    }
+  }
+
+  return ok;
+}
+
+int main(int argc, char* argv[]) {
+
+  if (argc <= 2) {
+    std::cerr << "usage: " << (argc > 0 ? argv[0] : "<program>")
+        << " <world.json.replay> <age> [world_out.json]" << std::endl
+        << "       " << (argc > 0 ? argv[0] : "<program>")
+        << " <world.json.replay> verify" << std::endl;
+    return -1;
+  }
+
+  std::string dir_name = argv[1];
+
+  if (std::string(argv[2]) == "verify") {
+    return verify(dir_name) ? 0 : 1;
+  }
+
+  uint64_t age = std::stoull(argv[2]);
+
+  auto time_beg = std::chrono::steady_clock::now();
+
+  world_t world;
+  if (!replay_log_t::seek(dir_name, age, world)) {
+    return 1;
+  }
+
+  double time_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - time_beg).count();
+  std::cout << "age " << world.stats.age
+      << "   microbes_count " << world.stats.microbes_count
+      << "   hash " << std::hex << world.hash() << std::dec
+      << "   time_s " << time_s
+      << std::endl;
+
+  // in the format of the logged config, the world of a run that goes on from here
+  if (argc > 3) {
+    std::error_code ec;
+    world.world_file_name = std::filesystem::absolute(argv[3], ec);
+    if (ec) {
+      std::cerr << "invalid path: " << ec.message().c_str() << std::endl;
+      return -1;
+    }
+    world.save_data();
+  }
+
+  return 0;
+}
+
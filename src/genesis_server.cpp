@@ -0,0 +1,243 @@
+
+#include <csignal>
+#include <iostream>
+#include "genesis_view.h"
+
+using namespace genesis_n;
+
+// set by SIGINT and SIGTERM, the world is saved on the way out
+static std::atomic<bool> stopping = false;
+
+
+
+// The world on a thread of its own and its viewers on the main one. A viewer costs the
+// simulation the frames it asks for, built between ticks; nothing while none is attached.
+struct genesis_server_t {
+  using protocol_t = view_protocol_t;
+
+  struct client_t {
+    int                    fd         = -1;
+    bool                   want       = false; // a frame was asked for and is not sent yet
+    bool                   requested  = false; // the frame was asked of the world
+    frame_request_t        request    = {};
+    uint64_t               seq_min    = {};    // the frame is one built after the request
+    frame_t::cells_t       cells      = {};    // of the last frame sent, the base of the next one
+  };
+
+  std::string            config_file_name;
+  std::string            world_file_name;
+  std::string            socket_path;
+
+  world_local_t          world;
+  std::thread            thread_world     = {};
+  int                    fd_listen        = -1;
+  std::vector<client_t>  clients          = {};
+  size_t                 serving          = {};    // clients index, round-robin
+  const frame_t*         frame            = {};
+  std::vector<uint8_t>   payload          = {};
+
+  bool init() {
+    sockaddr_un address;
+    if (!protocol_t::socket_address(socket_path, address)) {
+      return false;
+    }
+
+    // a socket file left by a server that did not exit cleanly
+    unlink(socket_path.c_str());
+
+    fd_listen = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd_listen < 0
+        || bind(fd_listen, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0
+        || listen(fd_listen, 8) < 0) {
+      std::cerr << "can not listen on " << socket_path << ": " << strerror(errno) << std::endl;
+      return false;
+    }
+
+    world.init(config_file_name, world_file_name);
+    thread_world = std::thread([this] { world.update(); });
+    return true;
+  }
+
+  void deinit() {
+    world.stop();
+    thread_world.join();
+    for (auto& client : clients) {
+      close(client.fd);
+    }
+    close(fd_listen);
+    unlink(socket_path.c_str());
+  }
+
+  void loop() {
+    std::vector<pollfd> fds;
+    while (!stopping) {
+      fds.assign(1, {.fd=fd_listen, .events=POLLIN, .revents=0});
+      for (const auto& client : clients) {
+        fds.push_back({.fd=client.fd, .events=POLLIN, .revents=0});
+      }
+
+      // while a frame is awaited the world is checked every ms
+      bool waiting = std::any_of(clients.begin(), clients.end(), [](const auto& client) { return client.want; });
+      if (poll(fds.data(), fds.size(), waiting ? 1 : 100) < 0 && errno != EINTR) {
+        std::cerr << "poll failed: " << strerror(errno) << std::endl;
+        break;
+      }
+
+      for (size_t ind{}; ind < clients.size(); ++ind) {
+        if (fds[ind + 1].revents && !receive(clients[ind])) {
+          close(clients[ind].fd);
+          clients[ind].fd = -1;
+        }
+      }
+
+      if (fds[0].revents & POLLIN) {
+        accept_client();
+      }
+
+      serve();
+
+      std::erase_if(clients, [](const auto& client) { return client.fd < 0; });
+    }
+  }
+
+  void accept_client() {
+    int fd = accept(fd_listen, nullptr, nullptr);
+    if (fd < 0) {
+      return;
+    }
+
+    // a viewer that stops reading is dropped instead of holding up the others
+    timeval timeout = {.tv_sec=1, .tv_usec=0};
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    clients.push_back({.fd=fd});
+    std::cerr << "viewer attached, " << clients.size() << " now" << std::endl;
+  }
+
+  // a message of the client; false when it went away or sent garbage
+  bool receive(client_t& client) {
+    protocol_t::header_t header;
+    if (!protocol_t::recv(client.fd, header, payload, stopping)) {
+      std::cerr << "viewer detached" << std::endl;
+      return false;
+    }
+
+    switch (header.type) {
+      case protocol_t::MSG_FRAME: {
+        protocol_t::request_t request;
+        if (payload.size() != sizeof(request)) {
+          return false;
+        }
+        std::memcpy(&request, payload.data(), sizeof(request));
+        client.request   = protocol_t::load_request(request);
+        client.want      = true;
+        client.requested = false;
+        break;
+
+      } case protocol_t::MSG_CONFIG: {
+        if (!frame || !frame->valid) {
+          return false;
+        }
+        config_t config = *frame->config;
+        nlohmann::json json;
+        config_json_wrapper_t(config).save(json);
+        std::string text = json.dump();
+        return protocol_t::send(client.fd, protocol_t::MSG_CONFIG, {reinterpret_cast<const uint8_t*>(text.data()), text.size()});
+
+      } case protocol_t::MSG_PAUSE: {
+        world.pause();
+        break;
+
+      } case protocol_t::MSG_RELOAD: {
+        world.need_update();
+        break;
+
+      } case protocol_t::MSG_SAVE: {
+        world.need_save();
+        break;
+
+      } case protocol_t::MSG_TRACE: {
+        world.need_trace();
+        break;
+      }
+    }
+    return true;
+  }
+
+  // One viewer at a time is asked of the world, the next one once its frame is sent
+  void serve() {
+    for (size_t count{}; count < clients.size(); ++count, ++serving) {
+      auto& client = clients[serving % clients.size()];
+      if (client.fd < 0 || !client.want) {
+        continue;
+      }
+
+      // a frame published before the request may be seconds old, it is taken out first
+      if (!client.requested) {
+        frame = &world.get_frame();
+        client.seq_min   = frame->seq + 1;
+        client.requested = true;
+        world.request_frame(client.request);
+      }
+
+      frame = &world.get_frame();
+      if (!frame->valid || frame->request != client.request || frame->seq < client.seq_min) {
+        return;
+      }
+
+      // against the cells this viewer has, a keyframe when the viewport changed its size
+      protocol_t::save_frame(*frame, client.cells, payload);
+      if (!protocol_t::send(client.fd, protocol_t::MSG_FRAME, payload)) {
+        std::cerr << "viewer dropped" << std::endl;
+        close(client.fd);
+        client.fd = -1;
+      }
+      client.want = false;
+      ++serving;
+      return;
+    }
+  }
+};
+
+int main(int argc, char* argv[]) {
+
+  if (argc <= 3) {
+    std::cerr << "usage: " << (argc > 0 ? argv[0] : "<program>")
+        << " <config.json> <world.json> <socket>" << std::endl;
+    return -1;
+  }
+
+  std::error_code ec;
+  std::string config_file_name = std::filesystem::absolute(argv[1], ec);
+
+  if (ec) {
+    std::cerr << "invalid path: " << ec.message().c_str() << std::endl;
+    return -1;
+  }
+
+  std::string world_file_name = std::filesystem::absolute(argv[2], ec);
+
+  if (ec) {
+    std::cerr << "invalid path: " << ec.message().c_str() << std::endl;
+    return -1;
+  }
+
+  struct sigaction action = {};
+  action.sa_handler = [](int) { stopping = true; };
+  sigaction(SIGINT, &action, nullptr);
+  sigaction(SIGTERM, &action, nullptr);
+
+  genesis_server_t server;
+
+  server.config_file_name = config_file_name;
+  server.world_file_name  = world_file_name;
+  server.socket_path      = argv[3];
+
+  if (!server.init()) {
+    return -1;
+  }
+  server.loop();
+  server.deinit();
+
+  return 0;
+}
+
@@ -0,0 +1,861 @@
+
+#include <csignal>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "genesis.h"
+
+using namespace genesis_n;
+
+// set by SIGINT and SIGTERM, the shards are saved on the way out
+static std::atomic<bool> stopping = false;
+
+
+
+// A rectangle of world cells, [beg, end)
+struct shard_rect_t {
+  size_t   x_beg   = {};
+  size_t   y_beg   = {};
+  size_t   x_end   = {};
+  size_t   y_end   = {};
+
+  bool contains(size_t x, size_t y) const {
+    return x >= x_beg && x < x_end && y >= y_beg && y < y_end;
+  }
+
+  shard_rect_t intersect(const shard_rect_t& rect) const {
+    shard_rect_t result = {
+      std::max(x_beg, rect.x_beg), std::max(y_beg, rect.y_beg),
+      std::min(x_end, rect.x_end), std::min(y_end, rect.y_end)};
+    if (result.x_beg >= result.x_end || result.y_beg >= result.y_end) {
+      return {};
+    }
+    return result;
+  }
+};
+
+// The world cut into shards_x by shards_y rectangles, the last column and row of shards
+// take the remainder. A shard updates its own cells and sees a halo of one cell around
+// them, on the sides where it has neighbours; the world does not wrap around.
+struct shard_layout_t {
+  size_t   x_max      = {};
+  size_t   y_max      = {};
+  size_t   shards_x   = 1;
+  size_t   shards_y   = 1;
+
+  size_t count() const {
+    return shards_x * shards_y;
+  }
+
+  shard_rect_t owned(size_t shard) const {
+    size_t sx = shard % shards_x;
+    size_t sy = shard / shards_x;
+    size_t w  = x_max / shards_x;
+    size_t h  = y_max / shards_y;
+    return {sx * w, sy * h,
+        sx + 1 == shards_x ? x_max : (sx + 1) * w,
+        sy + 1 == shards_y ? y_max : (sy + 1) * h};
+  }
+
+  // the owned cells and the halo, the grid of the shard's world
+  shard_rect_t local(size_t shard) const {
+    auto rect = owned(shard);
+    rect.x_beg -= rect.x_beg > 0;
+    rect.y_beg -= rect.y_beg > 0;
+    rect.x_end += rect.x_end < x_max;
+    rect.y_end += rect.y_end < y_max;
+    return rect;
+  }
+
+  size_t owner(size_t x, size_t y) const {
+    size_t sx = std::min(x / (x_max / shards_x), shards_x - 1);
+    size_t sy = std::min(y / (y_max / shards_y), shards_y - 1);
+    return sx + sy * shards_x;
+  }
+
+  // the up to eight shards around one
+  std::vector<size_t> neighbours(size_t shard) const {
+    std::vector<size_t> result;
+    int64_t sx = shard % shards_x;
+    int64_t sy = shard / shards_x;
+    for (int64_t y = sy - 1; y <= sy + 1; ++y) {
+      for (int64_t x = sx - 1; x <= sx + 1; ++x) {
+        if ((x != sx || y != sy) && x >= 0 && x < int64_t(shards_x) && y >= 0 && y < int64_t(shards_y)) {
+          result.push_back(x + y * shards_x);
+        }
+      }
+    }
+    return result;
+  }
+
+  // the link of src to the neighbour dst, 8 per shard
+  size_t link(size_t src, size_t dst) const {
+    int64_t dx  = int64_t(dst % shards_x) - int64_t(src % shards_x);
+    int64_t dy  = int64_t(dst / shards_x) - int64_t(src / shards_x);
+    int64_t dir = (dy + 1) * 3 + dx + 1;
+    return src * 8 + (dir < 4 ? dir : dir - 1);
+  }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+// A cell as the shards send it: this header, then the cell's resources, the microbe's
+// resources, the code and the regs. The size is fixed by the config.
+struct shard_cell_t {
+  uint32_t    x                  = {}; // world cell
+  uint32_t    y                  = {};
+  uint64_t    family             = {};
+  res_val_t   age                = {};
+  uint8_t     alive              = {};
+  uint8_t     direction          = {};
+  int8_t      energy_remaining   = {};
+  uint8_t     reserved[3]        = {};
+
+  static size_t size(const config_t& config) {
+    size_t size = sizeof(shard_cell_t) + 2 * config.resources.size() * sizeof(res_val_t)
+        + config.code_size + config.regs_size;
+    return (size + 7) & ~size_t(7);
+  }
+};
+static_assert(sizeof(shard_cell_t) == 24);
+
+// A one way stream of messages between two shards, each a size and the bytes. A shard
+// reads the messages of its neighbours in the order they were sent, so a stream socket
+// can stand in for the ring when the shards are on other machines.
+struct shard_link_t {
+  virtual ~shard_link_t() = default;
+  virtual bool send(std::span<const uint8_t> message) = 0;
+  virtual bool recv(std::vector<uint8_t>& message) = 0;
+};
+
+// Everything the processes share, at the start of the mapping: the barrier, the requests
+// of the coordinator, the slots the shards publish their stats in, and the rings.
+struct shard_shm_t {
+  // the coordinator sets the requests, the last shard at a barrier takes them for all
+  struct header_t {
+    std::atomic<uint64_t>   arrived        = {};
+    std::atomic<uint64_t>   generation     = {};
+    std::atomic<uint64_t>   stop_request   = {};
+    std::atomic<uint64_t>   save_request   = {};
+    std::atomic<uint64_t>   stop           = {};
+    std::atomic<uint64_t>   save           = {};
+    std::atomic<uint64_t>   microbes_live  = {}; // of all the shards at the last barrier
+    std::atomic<uint64_t>   failed         = {}; // a process died, nobody waits any more
+  };
+
+  // written by the shard between ticks, an odd seq while it is being written
+  struct slot_t {
+    std::atomic<uint64_t>   seq            = {};
+    stats_t                 stats          = {};
+    uint64_t                microbes_live  = {}; // in the owned cells, after the exchange
+    uint64_t                migrated       = {}; // microbes received from the neighbours
+    uint64_t                dropped        = {}; // and lost, their cell was taken
+    uint64_t                saved          = {}; // age of the last save
+  };
+
+  // single producer single consumer, the bytes follow
+  struct ring_t {
+    std::atomic<uint64_t>   head           = {};
+    std::atomic<uint64_t>   tail           = {};
+  };
+
+  size_t       shards_count     = {};
+  size_t       ring_capacity    = {};
+  size_t       size             = {};
+  uint8_t*     data             = {};
+  header_t*    header           = {};
+  slot_t*      slots            = {};
+
+  static size_t align(size_t size) {
+    return (size + 63) & ~size_t(63);
+  }
+
+  size_t ring_size() const {
+    return align(sizeof(ring_t) + ring_capacity);
+  }
+
+  ring_t* ring(size_t link) const {
+    return reinterpret_cast<ring_t*>(data + align(sizeof(header_t)) + align(shards_count * sizeof(slot_t))
+        + link * ring_size());
+  }
+
+  // anonymous shared memory, inherited by the shards across fork
+  bool init(size_t shards, size_t capacity) {
+    shards_count  = shards;
+    ring_capacity = align(capacity);
+    size = align(sizeof(header_t)) + align(shards * sizeof(slot_t)) + shards * 8 * ring_size();
+    void* mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (mapping == MAP_FAILED) {
+      std::cerr << "can not map " << size << " bytes: " << strerror(errno) << std::endl;
+      return false;
+    }
+    data   = static_cast<uint8_t*>(mapping);
+    header = new (data) header_t;
+    slots  = new (data + align(sizeof(header_t))) slot_t[shards];
+    for (size_t link{}; link < shards * 8; ++link) {
+      new (ring(link)) ring_t;
+    }
+    return true;
+  }
+
+  void deinit() {
+    if (data) {
+      munmap(data, size);
+      data = {};
+    }
+  }
+
+  // spins while the other side is running, sleeps when it is not
+  template <typename F>
+  bool wait(F ready) const {
+    for (size_t spin{}; !ready(); ++spin) {
+      if (header->failed.load(std::memory_order_relaxed)) {
+        return false;
+      }
+      if (spin < 64) {
+        std::this_thread::yield();
+      } else {
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+      }
+    }
+    return true;
+  }
+
+  // all the shards between two ticks; the last to arrive takes the requests and sums the
+  // microbes, while every slot holds the same tick
+  bool barrier() {
+    uint64_t generation = header->generation.load(std::memory_order_acquire);
+    if (header->arrived.fetch_add(1, std::memory_order_acq_rel) + 1 == shards_count) {
+      header->arrived.store(0, std::memory_order_relaxed);
+      uint64_t microbes_live = {};
+      for (size_t shard{}; shard < shards_count; ++shard) {
+        microbes_live += slots[shard].microbes_live;
+      }
+      header->microbes_live.store(microbes_live, std::memory_order_relaxed);
+      header->stop.store(header->stop_request.load(), std::memory_order_relaxed);
+      header->save.store(header->save_request.exchange(0), std::memory_order_relaxed);
+      header->generation.store(generation + 1, std::memory_order_release);
+      return true;
+    }
+    return wait([&] { return header->generation.load(std::memory_order_acquire) != generation; });
+  }
+
+  void publish(size_t shard, const stats_t& stats, uint64_t microbes_live, uint64_t migrated, uint64_t dropped,
+      uint64_t saved)
+  {
+    auto& slot = slots[shard];
+    slot.seq.fetch_add(1, std::memory_order_acq_rel);
+    slot.stats         = stats;
+    slot.microbes_live = microbes_live;
+    slot.migrated = migrated;
+    slot.dropped  = dropped;
+    slot.saved    = saved;
+    slot.seq.fetch_add(1, std::memory_order_release);
+  }
+
+  void read(size_t shard, slot_t& copy) const {
+    auto& slot = slots[shard];
+    for (;;) {
+      uint64_t seq = slot.seq.load(std::memory_order_acquire);
+      if (seq & 1) {
+        std::this_thread::yield();
+        continue;
+      }
+      copy.stats         = slot.stats;
+      copy.microbes_live = slot.microbes_live;
+      copy.migrated = slot.migrated;
+      copy.dropped  = slot.dropped;
+      copy.saved    = slot.saved;
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (slot.seq.load(std::memory_order_relaxed) == seq) {
+        return;
+      }
+    }
+  }
+};
+
+// A ring of the shared memory; a message is published with one store of the head
+struct shard_ring_link_t : shard_link_t {
+  shard_shm_t&            shm;
+  shard_shm_t::ring_t*    ring;
+  uint8_t*                bytes;
+
+  shard_ring_link_t(shard_shm_t& shm, size_t link)
+      : shm(shm), ring(shm.ring(link)), bytes(reinterpret_cast<uint8_t*>(ring) + sizeof(shard_shm_t::ring_t)) {}
+
+  void copy_in(uint64_t pos, const uint8_t* src, size_t size) {
+    for (size_t done{}; done < size;) {
+      size_t offset = (pos + done) % shm.ring_capacity;
+      size_t chunk  = std::min(size - done, shm.ring_capacity - offset);
+      std::memcpy(bytes + offset, src + done, chunk);
+      done += chunk;
+    }
+  }
+
+  void copy_out(uint64_t pos, uint8_t* dst, size_t size) const {
+    for (size_t done{}; done < size;) {
+      size_t offset = (pos + done) % shm.ring_capacity;
+      size_t chunk  = std::min(size - done, shm.ring_capacity - offset);
+      std::memcpy(dst + done, bytes + offset, chunk);
+      done += chunk;
+    }
+  }
+
+  bool send(std::span<const uint8_t> message) override {
+    uint64_t size = message.size();
+    if (sizeof(size) + size > shm.ring_capacity) {
+      return false;
+    }
+    uint64_t head = ring->head.load(std::memory_order_relaxed);
+    if (!shm.wait([&] { return head + sizeof(size) + size - ring->tail.load(std::memory_order_acquire) <= shm.ring_capacity; })) {
+      return false;
+    }
+    copy_in(head, reinterpret_cast<const uint8_t*>(&size), sizeof(size));
+    copy_in(head + sizeof(size), message.data(), size);
+    ring->head.store(head + sizeof(size) + size, std::memory_order_release);
+    return true;
+  }
+
+  bool recv(std::vector<uint8_t>& message) override {
+    uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+    if (!shm.wait([&] { return ring->head.load(std::memory_order_acquire) != tail; })) {
+      return false;
+    }
+    uint64_t size;
+    copy_out(tail, reinterpret_cast<uint8_t*>(&size), sizeof(size));
+    message.resize(size);
+    copy_out(tail + sizeof(size), message.data(), size);
+    ring->tail.store(tail + sizeof(size) + size, std::memory_order_release);
+    return true;
+  }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+// A shard in a process of its own: a world of its owned cells and the halo, the halo
+// refreshed from the neighbours after every tick. Microbes that moved, or were born,
+// into the halo are sent to the shard that owns the cell.
+struct shard_worker_t {
+  struct neighbour_t {
+    size_t                          shard   = {};
+    std::unique_ptr<shard_link_t>   out     = {};
+    std::unique_ptr<shard_link_t>   in      = {};
+    shard_rect_t                    strip   = {}; // owned cells in the neighbour's halo
+    std::vector<uint8_t>            message = {};
+  };
+
+  shard_shm_t&              shm;
+  shard_layout_t            layout;
+  size_t                    shard;
+  size_t                    ticks;          // 0 to run until stopped
+  shard_rect_t              owned           = {};
+  shard_rect_t              local           = {};
+  world_t                   world           = {};
+  std::vector<neighbour_t>  neighbours      = {};
+  std::vector<size_t>       halo            = {}; // local indices
+  std::vector<uint8_t>      ghost           = {}; // per halo cell, a neighbour's microbe is shown there
+  std::vector<uint64_t>     ghost_family    = {};
+  std::vector<res_val_t>    ghost_age       = {};
+  size_t                    record_size     = {};
+  microbe_t                 microbe         = {};
+  std::vector<uint8_t>      message         = {};
+  uint64_t                  migrated        = {};
+  uint64_t                  dropped         = {};
+  uint64_t                  saved           = {};
+  uint64_t                  microbes_live   = {};
+  size_t                    spawn_min_count = {};
+  size_t                    spawn_max_count = {};
+
+  shard_worker_t(shard_shm_t& shm, const shard_layout_t& layout, size_t shard, size_t ticks)
+      : shm(shm), layout(layout), shard(shard), ticks(ticks) {}
+
+  static std::string file_name(const std::string& world_file_name, size_t shard) {
+    return world_file_name + ".shard" + std::to_string(shard);
+  }
+
+  // The config of the whole world, moved to the shard's grid
+  void init(const config_t& config, uint64_t seed, const std::string& world_file_name) {
+    owned = layout.owned(shard);
+    local = layout.local(shard);
+
+    world.config        = config;
+    world.config.x_max  = local.x_end - local.x_beg;
+    world.config.y_max  = local.y_end - local.y_beg;
+    // the shards are the processes, a shard ticks on its own thread
+    world.config.update_threads = 0;
+    // the areas keep emitting into every shard they reach, from the same draws
+    for (auto& resource : world.config.resources) {
+      for (auto& area : resource.areas) {
+        area.pos.first  -= local.x_beg;
+        area.pos.second -= local.y_beg;
+      }
+    }
+    // every shard makes the same spawn draws and keeps the microbes that land in its cells
+    world.config.spawn_pos.first  -= local.x_beg;
+    world.config.spawn_pos.second -= local.y_beg;
+    spawn_min_count = config.spawn_min_count;
+    spawn_max_count = config.spawn_max_count;
+
+    world.owned_beg       = {owned.x_beg - local.x_beg, owned.y_beg - local.y_beg};
+    world.owned_end       = {owned.x_end - local.x_beg, owned.y_end - local.y_beg};
+    world.global_beg      = {local.x_beg, local.y_beg};
+    world.global_x_max    = config.x_max;
+    world.seed            = seed;
+    world.world_file_name = file_name(world_file_name, shard);
+    if (std::filesystem::exists(world.world_file_name)) {
+      world.load_data();
+    } else {
+      world.cells.init(world.config);
+    }
+
+    for (size_t ind{}; ind < world.cells.size(); ++ind) {
+      if (!world.owned(ind)) {
+        halo.push_back(ind);
+      }
+    }
+    ghost.assign(world.cells.size(), false);
+    ghost_family.assign(world.cells.size(), {});
+    ghost_age.assign(world.cells.size(), {});
+
+    for (size_t neighbour : layout.neighbours(shard)) {
+      neighbours.push_back({
+        .shard = neighbour,
+        .out   = std::make_unique<shard_ring_link_t>(shm, layout.link(shard, neighbour)),
+        .in    = std::make_unique<shard_ring_link_t>(shm, layout.link(neighbour, shard)),
+        .strip = owned.intersect(layout.local(neighbour)),
+      });
+    }
+
+    record_size = shard_cell_t::size(world.config);
+    microbe.code.resize(world.config.code_size);
+    microbe.regs.resize(world.config.regs_size);
+    microbe.resources.resize(world.config.resources.size());
+  }
+
+  neighbour_t* find(size_t shard) {
+    for (auto& neighbour : neighbours) {
+      if (neighbour.shard == shard) {
+        return &neighbour;
+      }
+    }
+    return nullptr;
+  }
+
+  void save_cell(size_t ind, uint8_t* record) {
+    auto& cells = world.cells;
+    shard_cell_t header = {
+      .x                  = uint32_t(ind % world.config.x_max + local.x_beg),
+      .y                  = uint32_t(ind / world.config.x_max + local.y_beg),
+      .family             = cells.family[ind],
+      .age                = cells.age[ind],
+      .alive              = cells.alive[ind],
+      .direction          = cells.direction[ind],
+      .energy_remaining   = cells.energy_remaining[ind],
+    };
+    std::memcpy(record, &header, sizeof(header));
+    auto* resources = reinterpret_cast<res_val_t*>(record + sizeof(header));
+    for (size_t res{}; res < cells.resources_count; ++res) {
+      resources[res]                         = cells.resources_cell[res * cells.count + ind];
+      resources[cells.resources_count + res] = cells.resources_microbe[res * cells.count + ind];
+    }
+    uint8_t* code = record + sizeof(header) + 2 * cells.resources_count * sizeof(res_val_t);
+    uint8_t* regs = code + cells.code_size;
+    if (cells.alive[ind]) {
+      std::copy_n(cells.genome[ind]->code.begin(), cells.code_size, code);
+      auto slot_regs = cells.arena.regs(cells.slot[ind]);
+      std::copy_n(slot_regs.begin(), cells.regs_size, regs);
+    } else {
+      std::fill_n(code, cells.code_size + cells.regs_size, 0);
+    }
+  }
+
+  // the microbe of the record, and with resources the cell's resources too
+  void load_cell(size_t ind, const uint8_t* record, bool resources_cell) {
+    auto& cells = world.cells;
+    shard_cell_t header;
+    std::memcpy(&header, record, sizeof(header));
+    const uint8_t* resources = record + sizeof(header);
+    const uint8_t* code      = resources + 2 * cells.resources_count * sizeof(res_val_t);
+
+    microbe.alive              = header.alive;
+    microbe.family             = header.family;
+    microbe.age                = header.age;
+    microbe.direction          = header.direction;
+    microbe.energy_remaining   = header.energy_remaining;
+    for (size_t res{}; res < cells.resources_count; ++res) {
+      res_val_t resource_cell;
+      std::memcpy(&resource_cell, resources + res * sizeof(res_val_t), sizeof(res_val_t));
+      std::memcpy(&microbe.resources[res], resources + (cells.resources_count + res) * sizeof(res_val_t),
+          sizeof(res_val_t));
+      if (resources_cell) {
+        cells.resources_cell[res * cells.count + ind] = resource_cell;
+      }
+    }
+    std::copy_n(code, cells.code_size, microbe.code.begin());
+    std::copy_n(code + cells.code_size, cells.regs_size, microbe.regs.begin());
+    cells.load_microbe(ind, microbe);
+  }
+
+  size_t local_ind(const uint8_t* record) const {
+    shard_cell_t header;
+    std::memcpy(&header, record, sizeof(header));
+    return (header.x - local.x_beg) + (header.y - local.y_beg) * world.config.x_max;
+  }
+
+  // the microbes that entered the halo go to the owners of their cells
+  bool send_migrants() {
+    for (auto& neighbour : neighbours) {
+      neighbour.message.clear();
+    }
+    for (size_t ind : halo) {
+      auto& cells = world.cells;
+      if (!cells.alive[ind]
+          || (ghost[ind] && cells.family[ind] == ghost_family[ind] && cells.age[ind] == ghost_age[ind]))
+      {
+        continue;
+      }
+      auto* neighbour = find(layout.owner(ind % world.config.x_max + local.x_beg, ind / world.config.x_max + local.y_beg));
+      auto& message   = neighbour->message;
+      message.resize(message.size() + record_size);
+      save_cell(ind, message.data() + message.size() - record_size);
+      cells.kill(ind);
+      ghost[ind] = false;
+    }
+    for (auto& neighbour : neighbours) {
+      if (!neighbour.out->send(neighbour.message)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // a migrant whose cell was taken in the same tick is lost
+  bool recv_migrants() {
+    for (auto& neighbour : neighbours) {
+      if (!neighbour.in->recv(message) || message.size() % record_size) {
+        return false;
+      }
+      for (size_t offset{}; offset < message.size(); offset += record_size) {
+        size_t ind = local_ind(message.data() + offset);
+        if (world.cells.alive[ind]) {
+          dropped++;
+          continue;
+        }
+        load_cell(ind, message.data() + offset, false);
+        world.cells.mark_dirty(ind, 0);
+        migrated++;
+      }
+    }
+    return true;
+  }
+
+  bool send_strips() {
+    for (auto& neighbour : neighbours) {
+      const auto& strip = neighbour.strip;
+      auto& message = neighbour.message;
+      message.resize((strip.x_end - strip.x_beg) * (strip.y_end - strip.y_beg) * record_size);
+      uint8_t* record = message.data();
+      for (size_t y = strip.y_beg; y < strip.y_end; ++y) {
+        for (size_t x = strip.x_beg; x < strip.x_end; ++x, record += record_size) {
+          save_cell((x - local.x_beg) + (y - local.y_beg) * world.config.x_max, record);
+        }
+      }
+      if (!neighbour.out->send(message)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // the halo becomes the neighbours' cells as they are now
+  bool recv_strips() {
+    for (auto& neighbour : neighbours) {
+      if (!neighbour.in->recv(message) || message.size() % record_size) {
+        return false;
+      }
+      for (size_t offset{}; offset < message.size(); offset += record_size) {
+        size_t ind = local_ind(message.data() + offset);
+        load_cell(ind, message.data() + offset, true);
+        world.cells.mark_dirty(ind, 0);
+        ghost[ind]        = world.cells.alive[ind];
+        ghost_family[ind] = world.cells.family[ind];
+        ghost_age[ind]    = world.cells.age[ind];
+      }
+    }
+    return true;
+  }
+
+  void publish() {
+    microbes_live = std::count_if(world.cells.live.begin(), world.cells.live.end(),
+        [&](uint32_t ind) { return world.owned(ind); });
+    shm.publish(shard, world.stats, microbes_live, migrated, dropped, saved);
+  }
+
+  // The spawn limits are of the whole world: the shard's count stands in for it, less the
+  // microbes the other shards had at the start of the tick
+  void update_spawn() {
+    uint64_t others = shm.header->microbes_live.load(std::memory_order_relaxed) - microbes_live;
+    bool spawn = others <= spawn_min_count;
+    world.config.spawn_min_count = spawn ? spawn_min_count - others : 0;
+    world.config.spawn_max_count = spawn ? std::max(spawn_max_count, others) - others : 0;
+  }
+
+  void save() {
+    world.save_data();
+    saved = world.stats.age;
+  }
+
+  bool run() {
+    if (!send_strips() || !recv_strips()) {
+      return false;
+    }
+    publish();
+    if (!shm.barrier()) {
+      return false;
+    }
+
+    for (;;) {
+      update_spawn();
+      world.update_world();
+      if (!send_migrants() || !recv_migrants() || !send_strips() || !recv_strips()) {
+        return false;
+      }
+      publish();
+      if (!shm.barrier()) {
+        return false;
+      }
+
+      bool stop = shm.header->stop.load(std::memory_order_relaxed) || (ticks && world.stats.age >= ticks);
+      if (stop || shm.header->save.load(std::memory_order_relaxed)) {
+        save();
+        publish();
+      }
+      if (stop) {
+        return true;
+      }
+    }
+  }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+// The layout of a saved sharded world, next to the shard files
+static bool load_manifest(const std::string& file_name, shard_layout_t& layout) {
+  if (!std::filesystem::exists(file_name)) {
+    return true;
+  }
+  nlohmann::json json;
+  if (!utils_t::load(json, file_name)) {
+    std::cerr << "can not load " << file_name << std::endl;
+    return false;
+  }
+  if (json.value("x_max", size_t{}) != layout.x_max || json.value("y_max", size_t{}) != layout.y_max
+      || json.value("shards_x", size_t{}) != layout.shards_x || json.value("shards_y", size_t{}) != layout.shards_y)
+  {
+    std::cerr << "the world " << file_name << " was saved with another layout: " << json.dump() << std::endl;
+    return false;
+  }
+  return true;
+}
+
+static bool save_manifest(const std::string& file_name, const shard_layout_t& layout) {
+  nlohmann::json json;
+  json["x_max"]    = layout.x_max;
+  json["y_max"]    = layout.y_max;
+  json["shards_x"] = layout.shards_x;
+  json["shards_y"] = layout.shards_y;
+  json["shards"]   = nlohmann::json::array();
+  for (size_t shard{}; shard < layout.count(); ++shard) {
+    auto rect = layout.owned(shard);
+    json["shards"].push_back({
+      {"x_beg", rect.x_beg}, {"y_beg", rect.y_beg}, {"x_end", rect.x_end}, {"y_end", rect.y_end},
+      {"file",  std::filesystem::path(shard_worker_t::file_name(file_name, shard)).filename().string()},
+    });
+  }
+  return utils_t::save(json, file_name);
+}
+
+int main(int argc, char* argv[]) {
+
+  if (argc <= 4) {
+    std::cerr << "usage: " << (argc > 0 ? argv[0] : "<program>")
+        << " <config.json> <world.json> <shards_x> <shards_y> [ticks]" << std::endl;
+    return -1;
+  }
+
+  std::error_code ec;
+  std::string config_file_name = std::filesystem::absolute(argv[1], ec);
+
+  if (ec) {
+    std::cerr << "invalid path: " << ec.message().c_str() << std::endl;
+    return -1;
+  }
+
+  std::string world_file_name = std::filesystem::absolute(argv[2], ec);
+
+  if (ec) {
+    std::cerr << "invalid path: " << ec.message().c_str() << std::endl;
+    return -1;
+  }
+
+  config_t config;
+  if (!config_json_wrapper_t(config).load(config_file_name)) {
+    std::cerr << "can not load config " << config_file_name << std::endl;
+    return -1;
+  }
+  utils_t::set_debug(config.debug);
+
+  shard_layout_t layout = {
+    .x_max    = config.x_max,
+    .y_max    = config.y_max,
+    .shards_x = std::stoul(argv[3]),
+    .shards_y = std::stoul(argv[4]),
+  };
+  size_t ticks = argc > 5 ? std::stoul(argv[5]) : 0;
+
+  // the halo of a shard must not reach past its neighbours
+  if (!layout.shards_x || !layout.shards_y
+      || layout.x_max / layout.shards_x < 3 || layout.y_max / layout.shards_y < 3)
+  {
+    std::cerr << "invalid shards " << layout.shards_x << " x " << layout.shards_y
+        << " of a world of " << layout.x_max << " x " << layout.y_max << std::endl;
+    return -1;
+  }
+
+  if (!load_manifest(world_file_name, layout) || !save_manifest(world_file_name, layout)) {
+    return -1;
+  }
+
+  uint64_t seed = config.seed ? config.seed : time(0);
+
+  // a ring holds the two messages of a tick, the migrants and the strip, of a whole side
+  size_t side = std::max(layout.x_max / layout.shards_x + layout.x_max % layout.shards_x,
+      layout.y_max / layout.shards_y + layout.y_max % layout.shards_y) + 2;
+  shard_shm_t shm;
+  if (!shm.init(layout.count(), 2 * (sizeof(uint64_t) + side * shard_cell_t::size(config)))) {
+    return -1;
+  }
+
+  struct sigaction action = {};
+  action.sa_handler = [](int) { stopping = true; };
+  sigaction(SIGINT, &action, nullptr);
+  sigaction(SIGTERM, &action, nullptr);
+
+  std::vector<pid_t>   pids;
+  shard_shm_t::slot_t  slot;
+  for (size_t shard{}; shard < layout.count(); ++shard) {
+    pid_t pid = fork();
+    if (pid < 0) {
+      std::cerr << "can not fork: " << strerror(errno) << std::endl;
+      shm.header->failed = true;
+      break;
+    }
+    if (!pid) {
+      // the coordinator stops the shards, through the shared memory
+      signal(SIGINT, SIG_IGN);
+      signal(SIGTERM, SIG_IGN);
+      bool ok = false;
+      try {
+        shard_worker_t worker(shm, layout, shard, ticks);
+        worker.init(config, seed, world_file_name);
+        ok = worker.run();
+      } catch (const std::exception& e) {
+        std::cerr << "shard " << shard << ": " << e.what() << std::endl;
+      }
+      if (!ok) {
+        shm.header->failed = true;
+      }
+      _exit(ok ? 0 : 1);
+    }
+    pids.push_back(pid);
+  }
+
+  size_t   running    = pids.size();
+  bool     failed     = shm.header->failed;
+
+  // the shards that have exited; one killed by a signal sets nothing itself, so the
+  // others are released from their waits here
+  auto reap = [&] {
+    if (stopping) {
+      shm.header->stop_request = true;
+    }
+    for (auto& pid : pids) {
+      int status;
+      if (pid > 0 && waitpid(pid, &status, WNOHANG) == pid) {
+        pid = -1;
+        running--;
+        if (!WIFEXITED(status) || WEXITSTATUS(status)) {
+          shm.header->failed = true;
+          failed = true;
+        }
+      }
+    }
+  };
+
+  // the age the shards start at, once they have loaded; none exits before it publishes
+  shm.wait([&] {
+    reap();
+    if (running < pids.size()) {
+      shm.header->failed = true;
+      failed = true;
+    }
+    return stopping || std::all_of(shm.slots, shm.slots + layout.count(), [](const auto& slot) {
+      return slot.seq.load() > 0;
+    });
+  });
+  shm.read(0, slot);
+
+  uint64_t age_prev   = slot.stats.age;
+  auto     time_stats = std::chrono::steady_clock::now();
+  auto     time_save  = time_stats;
+
+  while (running) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+    reap();
+
+    auto time_now = std::chrono::steady_clock::now();
+    if (config.interval_save_world_ms
+        && time_now - time_save >= std::chrono::milliseconds(config.interval_save_world_ms))
+    {
+      shm.header->save_request = true;
+      time_save = time_now;
+    }
+
+    // and once more for the ticks since, on the way out
+    if (config.interval_stats_ms
+        && (time_now - time_stats >= std::chrono::milliseconds(config.interval_stats_ms) || !running))
+    {
+      // the shards agree on the age at every barrier, they are at most a tick apart
+      uint64_t age = uint64_t(-1), microbes_count = {}, migrated = {}, dropped = {};
+      for (size_t shard{}; shard < layout.count(); ++shard) {
+        shm.read(shard, slot);
+        age             = std::min(age, slot.stats.age);
+        microbes_count += slot.stats.microbes_count;
+        migrated       += slot.migrated;
+        dropped        += slot.dropped;
+      }
+      if (age == age_prev && !running) {
+        break;
+      }
+      double time_s = std::chrono::duration<double>(time_now - time_stats).count();
+      std::cout << "age " << age
+          << "   microbes_count " << microbes_count
+          << "   ticks_per_s " << (age - age_prev) / std::max(time_s, 1e-9)
+          << "   migrated " << migrated
+          << "   dropped " << dropped
+          << std::endl;
+      age_prev   = age;
+      time_stats = time_now;
+    }
+  }
+
+  shm.deinit();
+
+  std::cout << (failed ? "failed" : "end") << std::endl;
+
+  return failed ? 1 : 0;
+}
+
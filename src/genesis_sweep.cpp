@@ -0,0 +1,244 @@
+
+#include <iostream>
+#include <unordered_set>
+#include "genesis.h"
+
+// The sweep file: the base config, the grid of values to override in it, and when a run stops.
+// Grid keys are config fields, or JSON pointers into the config for nested values; every
+// combination of the values is run repeat times, with seeds seed, seed + 1, ...
+//
+//   {
+//     "config":        "json/benchmark_config.json",
+//     "ticks":         1000,
+//     "stop_microbes": 0,
+//     "repeat":        2,
+//     "seed":          1,
+//     "grid": {
+//       "mutation_probability":   [0.01, 0.1],
+//       "energy_remaining":       [1, 3],
+//       "/recipes/2/in_out/0/1":  [-400, -800]
+//     }
+//   }
+struct sweep_t {
+  using grid_t = std::vector<std::pair<std::string, std::vector<nlohmann::json>>>;
+
+  std::string   config_file_name   = {};
+  size_t        ticks              = 1000;
+  size_t        stop_microbes      = 0;    // extinct once the microbes that were more fall to this
+  size_t        repeat             = 1;
+  uint64_t      seed               = 1;
+  grid_t        grid               = {};
+};
+
+// a world of the sweep: a point of the grid and a seed
+struct sweep_run_t {
+  size_t                 ind       = {};
+  uint64_t               seed      = {};
+  nlohmann::json         params    = {}; // grid key to value
+  genesis_n::config_t    config    = {};
+};
+
+static bool load_sweep(const std::string& file_name, sweep_t& sweep, std::vector<sweep_run_t>& runs) {
+  using namespace genesis_n;
+
+  nlohmann::json json;
+  if (!utils_t::load(json, file_name)) {
+    std::cerr << "can not load sweep " << file_name << std::endl;
+    return false;
+  }
+
+  sweep.config_file_name = json.value("config", sweep.config_file_name);
+  sweep.ticks            = json.value("ticks", sweep.ticks);
+  sweep.stop_microbes    = json.value("stop_microbes", sweep.stop_microbes);
+  sweep.repeat           = json.value("repeat", sweep.repeat);
+  sweep.seed             = json.value("seed", sweep.seed);
+  nlohmann::json grid = json.value("grid", nlohmann::json::object());
+  for (const auto& [key, values] : grid.items()) {
+    if (!values.is_array() || values.empty()) {
+      std::cerr << "invalid grid values of " << key << std::endl;
+      return false;
+    }
+    sweep.grid.push_back({key, values});
+  }
+
+  nlohmann::json config_base;
+  if (!utils_t::load(config_base, sweep.config_file_name)) {
+    std::cerr << "can not load config " << sweep.config_file_name << std::endl;
+    return false;
+  }
+
+  // the grid points in order, the last key varies fastest
+  size_t points = 1;
+  for (const auto& [key, values] : sweep.grid) {
+    points *= values.size();
+  }
+
+  for (size_t point{}; point < points; ++point) {
+    nlohmann::json config_json = config_base;
+    nlohmann::json params      = nlohmann::json::object();
+    size_t rest = point;
+    for (auto it = sweep.grid.rbegin(); it != sweep.grid.rend(); ++it) {
+      const auto& [key, values] = *it;
+      const auto& value = values[rest % values.size()];
+      rest /= values.size();
+      params[key] = value;
+      if (key.starts_with("/")) {
+        nlohmann::json::json_pointer pointer(key);
+        if (!config_json.contains(pointer)) {
+          std::cerr << "no config value at " << key << std::endl;
+          return false;
+        }
+        config_json[pointer] = value;
+      } else {
+        config_json[key] = value;
+      }
+    }
+
+    config_t config;
+    if (!config_json_wrapper_t(config).load(config_json)) {
+      std::cerr << "invalid config at " << params.dump() << std::endl;
+      return false;
+    }
+    // the runs share the machine, each world ticks on its own thread
+    config.update_threads = 0;
+
+    for (size_t ind{}; ind < sweep.repeat; ++ind) {
+      runs.push_back({.ind=runs.size(), .seed=sweep.seed + ind, .params=params, .config=config});
+    }
+  }
+
+  return true;
+}
+
+int main(int argc, char* argv[]) {
+
+  if (argc <= 2) {
+    std::cerr << "usage: " << (argc > 0 ? argv[0] : "<program>")
+        << " <sweep.json> <results.jsonl|results.csv> [threads]" << std::endl;
+    return -1;
+  }
+
+  std::string sweep_file_name   = argv[1];
+  std::string results_file_name = argv[2];
+  size_t      threads           = argc > 3 ? std::stoul(argv[3]) : std::max(1U, std::thread::hardware_concurrency());
+  bool        csv               = results_file_name.ends_with(".csv");
+
+  using namespace genesis_n;
+
+  sweep_t sweep;
+  std::vector<sweep_run_t> runs;
+  if (!load_sweep(sweep_file_name, sweep, runs)) {
+    return -1;
+  }
+
+  std::ofstream results(results_file_name);
+  if (!results) {
+    std::cerr << "can not open " << results_file_name << std::endl;
+    return -1;
+  }
+
+  // the params of the rows are the grid keys, in grid order
+  std::vector<std::string> columns = {"run", "seed"};
+  for (const auto& [key, values] : sweep.grid) {
+    columns.push_back(key);
+  }
+  for (const auto& column : {"stop", "ticks", "time_s", "ticks_per_s", "instructions_per_s",
+      "microbes_count", "microbes_max", "microbes_age_avg", "families", "genomes"}) {
+    columns.push_back(column);
+  }
+
+  auto csv_value = [](const nlohmann::json& value) {
+    std::string text = value.is_string() ? value.get<std::string>() : value.dump();
+    if (text.find_first_of(",\"\n") == std::string::npos) {
+      return text;
+    }
+    std::string quoted = "\"";
+    for (char c : text) {
+      quoted += c == '"' ? "\"\"" : std::string(1, c);
+    }
+    return quoted + "\"";
+  };
+
+  if (csv) {
+    for (size_t ind{}; ind < columns.size(); ++ind) {
+      results << (ind ? "," : "") << csv_value(columns[ind]);
+    }
+    results << std::endl;
+  }
+
+  std::mutex results_mutex;
+  size_t     runs_done = {};
+
+  // A world per task; the pool hands the next run to whichever thread is free, so the
+  // runs that end early, by extinction, leave their thread to the long ones
+  auto run_world = [&](size_t ind) {
+    auto& run = runs[ind];
+
+    world_t world;
+    world.config = run.config;
+    world.seed   = run.seed;
+    world.cells.init(world.config);
+
+    uint64_t    instructions = {};
+    uint64_t    microbes_max = {};
+    std::string stop         = "ticks";
+
+    auto time_beg = std::chrono::steady_clock::now();
+    for (size_t tick{}; tick < sweep.ticks; ++tick) {
+      world.update_world();
+      instructions += world.stats.instructions;
+      microbes_max  = std::max<uint64_t>(microbes_max, world.stats.microbes_count);
+      // the spawned microbes are counted from the tick after their spawn
+      if (microbes_max > sweep.stop_microbes && world.stats.microbes_count <= sweep.stop_microbes) {
+        stop = "extinct";
+        break;
+      }
+    }
+    auto time_end = std::chrono::steady_clock::now();
+
+    double time_s = std::chrono::duration<double>(time_end - time_beg).count();
+
+    std::unordered_set<uint64_t> families;
+    for (size_t cell{}; cell < world.cells.size(); ++cell) {
+      if (world.cells.alive[cell]) {
+        families.insert(world.cells.family[cell]);
+      }
+    }
+
+    nlohmann::json row;
+    row["run"]                = run.ind;
+    row["seed"]               = run.seed;
+    for (const auto& [key, value] : run.params.items()) {
+      row[key]                = value;
+    }
+    row["stop"]               = stop;
+    row["ticks"]              = world.stats.age;
+    row["time_s"]             = time_s;
+    row["ticks_per_s"]        = world.stats.age / std::max(time_s, 1e-9);
+    row["instructions_per_s"] = instructions / std::max(time_s, 1e-9);
+    row["microbes_count"]     = world.stats.microbes_count;
+    row["microbes_max"]       = microbes_max;
+    row["microbes_age_avg"]   = world.stats.microbes_age_avg;
+    row["families"]           = families.size();
+    row["genomes"]            = world.cells.genomes.size();
+
+    std::lock_guard lock(results_mutex);
+    if (csv) {
+      for (size_t ind{}; ind < columns.size(); ++ind) {
+        results << (ind ? "," : "") << csv_value(row[columns[ind]]);
+      }
+      results << std::endl;
+    } else {
+      results << row.dump() << std::endl;
+    }
+    std::cerr << "run " << ++runs_done << " / " << runs.size() << "   " << stop
+        << "   ticks " << world.stats.age << "   microbes_count " << world.stats.microbes_count
+        << "   " << run.params.dump() << std::endl;
+  };
+
+  thread_pool_t pool(std::min(threads, std::max<size_t>(runs.size(), 1)));
+  pool.run(runs.size(), run_world);
+
+  return results ? 0 : 1;
+}
+
@@ -0,0 +1,844 @@
+
+#include <atomic>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "genesis.h"
+
+
+
+namespace genesis_n {
+
+  // The cell under the mouse, in full
+  struct view_cell_t {
+    using resources_t   = std::vector<res_val_t>;
+
+    bool          alive;
+    uint64_t      family;
+    xy_pos_t      pos;
+    uint64_t      age;
+    resources_t   resources_microbe;
+    resources_t   resources_world;
+  };
+
+  // Render inputs of a block of step x step cells, a single cell at step 1; the resources
+  // are those of the frame's resource only
+  struct frame_cell_t {
+    uint32_t    family;             // low bits of the dominant family, the colour of MODE_FAMILY
+    res_val_t   age;                // mean over the live cells
+    res_val_t   resource_microbe;   // mean over the live cells
+    res_val_t   resource_world;     // mean over the cells
+    uint16_t    count;              // live cells
+
+    bool operator==(const frame_cell_t&) const = default;
+  };
+
+  // The visible cells, a frame cell per block of step cells a side
+  struct viewport_t {
+    inline static constexpr size_t STEP_MAX = 128; // step * step live cells fit frame_cell_t::count
+
+    size_t   x      = {};
+    size_t   y      = {};
+    size_t   w      = utils_t::npos; // in cells when requested, in frame cells in a frame
+    size_t   h      = utils_t::npos;
+    size_t   step   = 1;
+
+    bool operator==(const viewport_t&) const = default;
+  };
+
+  // What the viewer asks the next frames to hold
+  struct frame_request_t {
+    size_t       resource   = {}; // modulo config.resources
+    size_t       cell_ind   = utils_t::npos;
+    viewport_t   viewport   = {};
+
+    bool operator==(const frame_request_t&) const = default;
+  };
+
+  struct frame_t {
+    using cells_t    = std::vector<frame_cell_t>;
+    using config_p_t = std::shared_ptr<const config_t>;
+
+    bool              valid            = false;
+    uint64_t          seq              = {}; // frames built by the world up to this one, from 1
+    uint64_t          config_version   = {}; // configs reloaded before this one
+    config_p_t        config           = {}; // replaced when the config is reloaded, shared otherwise
+    frame_request_t   request          = {}; // the request the frame was built for
+    size_t            resource         = {}; // config.resources index of the cells
+    stats_t           stats            = {};
+    viewport_t        viewport         = {}; // clipped to the world
+    cells_t           cells            = {}; // viewport.w x viewport.h, row-major
+    size_t            cell_ind         = utils_t::npos; // the cell under the mouse, in full
+    view_cell_t       cell             = {};
+    std::string       error            = {}; // of the last config reload, empty when it went well
+  };
+
+  ////////////////////////////////////////////////////////////////////////////////
+
+  // Fills frames from the world between ticks; the scratch of the block sums is kept
+  struct frame_builder_t {
+    // sums of a row of blocks while the cells are aggregated
+    struct block_t {
+      uint32_t   count;
+      int64_t    age;
+      int64_t    resource_microbe;
+      int64_t    resource_world;
+      uint64_t   family;
+      int32_t    family_votes; // majority vote: the family of more than half, if there is one
+    };
+
+    std::vector<block_t>   blocks   = {};
+
+    // everything but the seq and the config, which belong to the caller
+    void build(world_t& world, const frame_request_t& request, frame_t& frame) {
+      const auto& config = world.config;
+      const auto& cells  = world.cells;
+
+      frame.request  = request;
+      frame.resource = request.resource % config.resources.size();
+      frame.stats    = world.stats;
+
+      // the viewport in whole blocks, clipped to the world
+      size_t x_max = config.x_max;
+      size_t y_max = config.y_max;
+      const auto& view = request.viewport;
+      auto& viewport = frame.viewport;
+      viewport.step  = std::clamp<size_t>(view.step, 1, viewport_t::STEP_MAX);
+      viewport.x     = std::min(view.x, x_max) / viewport.step * viewport.step;
+      viewport.y     = std::min(view.y, y_max) / viewport.step * viewport.step;
+      size_t x_end   = std::min(view.x + std::min(view.w, x_max), x_max);
+      size_t y_end   = std::min(view.y + std::min(view.h, y_max), y_max);
+      viewport.w     = (std::max(x_end, viewport.x) - viewport.x + viewport.step - 1) / viewport.step;
+      viewport.h     = (std::max(y_end, viewport.y) - viewport.y + viewport.step - 1) / viewport.step;
+      frame.cells.resize(viewport.w * viewport.h);
+
+      const res_val_t* resources_microbe = cells.resources_microbe.data() + frame.resource * cells.size();
+      const res_val_t* resources_world   = cells.resources_cell.data() + frame.resource * cells.size();
+
+      if (viewport.step == 1) {
+        for (size_t y{}; y < viewport.h; ++y) {
+          size_t ind_beg = viewport.x + (viewport.y + y) * x_max;
+          frame_cell_t* row = frame.cells.data() + y * viewport.w;
+          for (size_t x{}; x < viewport.w; ++x) {
+            size_t ind = ind_beg + x;
+            bool alive = cells.alive[ind];
+            row[x] = {
+              .family             = alive ? uint32_t(cells.family[ind]) : 0,
+              .age                = alive ? cells.age[ind] : res_val_t{},
+              .resource_microbe   = alive ? resources_microbe[ind] : res_val_t{},
+              .resource_world     = resources_world[ind],
+              .count              = alive,
+            };
+          }
+        }
+      } else {
+        // row-major over the cells, a row of blocks at a time
+        for (size_t by{}; by < viewport.h; ++by) {
+          blocks.assign(viewport.w, {});
+          size_t y_beg = viewport.y + by * viewport.step;
+          size_t y_end_block = std::min(y_beg + viewport.step, y_max);
+          for (size_t y = y_beg; y < y_end_block; ++y) {
+            for (size_t x = viewport.x; x < x_end; ++x) {
+              size_t ind = x + y * x_max;
+              auto& block = blocks[(x - viewport.x) / viewport.step];
+              block.resource_world += resources_world[ind];
+              if (!cells.alive[ind]) {
+                continue;
+              }
+              block.count++;
+              block.age              += cells.age[ind];
+              block.resource_microbe += resources_microbe[ind];
+              if (!block.family_votes) {
+                block.family = cells.family[ind];
+              }
+              block.family_votes += block.family == cells.family[ind] ? 1 : -1;
+            }
+          }
+
+          frame_cell_t* row = frame.cells.data() + by * viewport.w;
+          for (size_t bx{}; bx < viewport.w; ++bx) {
+            const auto& block = blocks[bx];
+            size_t block_x_beg = viewport.x + bx * viewport.step;
+            int64_t cells_count = (y_end_block - y_beg) * std::min(viewport.step, x_end - block_x_beg);
+            int64_t count = std::max<int64_t>(block.count, 1);
+            row[bx] = {
+              .family             = uint32_t(block.family),
+              .age                = res_val_t(block.age / count),
+              .resource_microbe   = res_val_t(block.resource_microbe / count),
+              .resource_world     = res_val_t(block.resource_world / cells_count),
+              .count              = uint16_t(block.count),
+            };
+          }
+        }
+      }
+
+      frame.cell_ind = request.cell_ind;
+      if (frame.cell_ind < cells.size()) {
+        auto  cell_ref = world.cells[frame.cell_ind];
+        auto& cell     = frame.cell;
+        cell.alive  = cell_ref.microbe.alive;
+        cell.family = cell_ref.microbe.family;
+        cell.age    = cell_ref.microbe.age;
+        cell.pos    = world.xy_pos_from_ind(frame.cell_ind);
+        cell.resources_microbe.resize(config.resources.size());
+        cell.resources_world.resize(config.resources.size());
+        for (size_t res{}; res < config.resources.size(); ++res) {
+          cell.resources_microbe[res] = cell.alive ? cell_ref.microbe.resources[res] : res_val_t{};
+          cell.resources_world[res]   = cell_ref.resources[res];
+        }
+      }
+    }
+  };
+
+  ////////////////////////////////////////////////////////////////////////////////
+
+  // Triple buffer: the producer fills the back frame and swaps it with the middle one, the
+  // viewer swaps its front frame with the middle one when that is fresh. Neither side waits,
+  // and the frames keep their buffers, so a frame allocates nothing once the sizes settle.
+  class frame_exchange_t {
+    inline static constexpr uint8_t FRESH = 4;
+
+    using frames_t = std::array<frame_t, 3>;
+
+    frames_t              _frames;
+    uint8_t               _back = 0;   // producer thread only
+    std::atomic<uint8_t>  _middle = 1; // frames index, FRESH once published
+    uint8_t               _front = 2;  // viewer thread only
+    std::atomic<size_t>   _resource = {};
+    std::atomic<size_t>   _cell_ind = utils_t::npos;
+    std::atomic<size_t>   _view_x = {};   // the fields of the requested viewport_t; a frame
+    std::atomic<size_t>   _view_y = {};   // taken while they change mixes two viewports,
+    std::atomic<size_t>   _view_w = utils_t::npos;   // which the next one corrects
+    std::atomic<size_t>   _view_h = utils_t::npos;
+    std::atomic<size_t>   _view_step = 1;
+    std::atomic<bool>     _need_data = false;
+
+   public:
+    // Producer: takes the request of the next frame, if the viewer asked for one since the last call
+    bool requested(frame_request_t& request) {
+      if (!_need_data.exchange(false)) {
+        return false;
+      }
+      request.resource      = _resource;
+      request.cell_ind      = _cell_ind;
+      request.viewport.x    = _view_x;
+      request.viewport.y    = _view_y;
+      request.viewport.w    = _view_w;
+      request.viewport.h    = _view_h;
+      request.viewport.step = _view_step;
+      return true;
+    }
+
+    // Producer: the frame to fill, then publish() it
+    frame_t& back() {
+      return _frames[_back];
+    }
+
+    void publish() {
+      _frames[_back].valid = true;
+      _back = _middle.exchange(_back | FRESH) & ~FRESH;
+    }
+
+    // Viewer: asks the producer for a frame
+    void request(const frame_request_t& request) {
+      _resource  = request.resource;
+      _cell_ind  = request.cell_ind;
+      _view_x    = request.viewport.x;
+      _view_y    = request.viewport.y;
+      _view_w    = request.viewport.w;
+      _view_h    = request.viewport.h;
+      _view_step = request.viewport.step;
+      _need_data = true;
+    }
+
+    // Viewer: the latest published frame, the previous one again until a newer one is
+    // published; it stays valid until the next call
+    const frame_t& front() {
+      if (_middle.load() & FRESH) {
+        _front = _middle.exchange(_front) & ~FRESH;
+      }
+      return _frames[_front];
+    }
+  };
+
+  ////////////////////////////////////////////////////////////////////////////////
+
+  // A world the viewer shows: run by a thread of this process, or by a genesis_server.
+  // The commands are flags the thread of update() takes between frames.
+  class world_source_t {
+   protected:
+    frame_exchange_t    _exchange;
+    std::atomic<bool>   _need_pause = false; // toggles the pause
+    std::atomic<bool>   _need_update = false;
+    std::atomic<bool>   _need_save = false;
+    std::atomic<bool>   _need_trace = false;
+    std::atomic<bool>   _stop = false;
+
+   public:
+    virtual ~world_source_t() = default;
+
+    // the thread that feeds the frames, until stop()
+    virtual void update() = 0;
+
+    void stop() {
+      _stop = true;
+    }
+
+    void pause() {
+      _need_pause = true;
+    }
+
+    void need_update() {
+      _need_update = true;
+    }
+
+    void need_save() {
+      _need_save = true;
+    }
+
+    // the trace rings to <world file>.trace.json
+    void need_trace() {
+      _need_trace = true;
+    }
+
+    // The latest frame, see frame_exchange_t::front(); the request selects the next frames
+    const frame_t& get_frame(const frame_request_t& request) {
+      const auto& frame = _exchange.front();
+      _exchange.request(request);
+      return frame;
+    }
+
+    // The latest frame, without asking for another one
+    const frame_t& get_frame() {
+      return _exchange.front();
+    }
+
+    void request_frame(const frame_request_t& request) {
+      _exchange.request(request);
+    }
+  };
+
+  // The simulation on the thread of update(); frames are built between ticks, only when asked for
+  class world_local_t : public world_source_t {
+    world_t               _world;
+    frame_builder_t       _builder;
+    frame_t::config_p_t   _config;
+    uint64_t              _config_version = {};
+    uint64_t              _seq = {};
+    bool                  _paused = false;
+    std::string           _error;
+
+    void publish(const frame_request_t& request) {
+      auto& frame = _exchange.back();
+      _builder.build(_world, request, frame);
+      frame.seq            = ++_seq;
+      frame.config         = _config;
+      frame.config_version = _config_version;
+      frame.error          = _error;
+      _exchange.publish();
+    }
+
+    // Reads the config file again and reloads the world, just saved, with it. A save that
+    // fails, a config that does not load or a world that does not load with it leave the
+    // run on the previous config and world; the error goes to the viewer with the frames.
+    void reload() {
+      config_t config = _world.config;
+      try {
+        _world.save_data();
+      } catch (const std::exception& e) {
+        _error = std::string("reload: ") + e.what();
+        return;
+      }
+
+      try {
+        _world.load_config();
+        _world.load_data();
+      } catch (const std::exception& e) {
+        LOG_GENESIS(ERROR, "reload failed, the previous config stays: %s", e.what());
+        _error = std::string("reload: ") + e.what();
+        _world.config = config;
+        _world.load_data();
+        return;
+      }
+
+      _error.clear();
+      _world.init_scheduler();
+      _world.replay.record(_world, utils_t::REPLAY_CONFIG);
+      _config = std::make_shared<const config_t>(_world.config);
+      _config_version++;
+    }
+
+   public:
+    void init(const std::string& config_file_name, const std::string& world_file_name) {
+      _world.config_file_name = config_file_name;
+      _world.world_file_name  = world_file_name;
+    }
+
+    void update() override {
+      _world.init();
+      _config = std::make_shared<const config_t>(_world.config);
+      while (!_stop) {
+        // served while paused too, the viewer still follows the mouse
+        frame_request_t request;
+        if (_exchange.requested(request)) {
+          publish(request);
+        }
+
+        if (_need_pause.exchange(false)) {
+          _paused = !_paused;
+        }
+
+        // written in the background, a save that is being written takes the flag on the next pass
+        if (_need_save && _world.save_data_async()) {
+          _need_save = false;
+        }
+
+        if (_need_trace.exchange(false)) {
+          _world.save_trace();
+        }
+
+        if (_paused) {
+          std::this_thread::sleep_for(scheduler_t::WAIT_MAX);
+          continue;
+        }
+        // sleeps while no tick is due, WAIT_MAX at most
+        _world.update();
+
+        if (_need_update) {
+          reload();
+          _need_update = false;
+        }
+      }
+      _world.save_data();
+      _world.save_trace();
+    }
+  };
+
+  ////////////////////////////////////////////////////////////////////////////////
+
+  // Messages between genesis_server and its viewers over a Unix stream socket: a header, then
+  // size bytes of payload. Values are in host byte order, both ends run on one machine and are
+  // built from one tree; the version changes with the layout of any message.
+  //
+  //   MSG_FRAME    viewer: request_t; server: frame_header_t, stats_t, the resources of the
+  //                cell under the mouse, the reload error, then the cells as runs against
+  //                the previous frame
+  //   MSG_CONFIG   viewer: nothing; server: the config as JSON text
+  //   MSG_PAUSE, MSG_RELOAD, MSG_SAVE, MSG_TRACE   viewer only, nothing both ways
+  //
+  // The viewer asks for a frame once it has the previous one, so the server keeps no queue.
+  struct view_protocol_t {
+    inline static constexpr uint32_t MAGIC      = 0x56534547; // "GESV"
+    inline static constexpr uint32_t VERSION    = 3;
+    inline static constexpr uint64_t PAYLOAD_MAX = 1ULL << 32;
+
+    enum msg_t : uint32_t {
+      MSG_FRAME,
+      MSG_CONFIG,
+      MSG_PAUSE,
+      MSG_RELOAD,
+      MSG_SAVE,
+      MSG_TRACE,
+      MSG_COUNT,
+    };
+
+    struct header_t {
+      uint32_t   magic      = MAGIC;
+      uint16_t   version    = VERSION;
+      uint16_t   type       = {};
+      uint64_t   size       = {};
+    };
+
+    struct request_t {
+      uint64_t   resource   = {};
+      uint64_t   cell_ind   = {};
+      uint64_t   x          = {};
+      uint64_t   y          = {};
+      uint64_t   w          = {};
+      uint64_t   h          = {};
+      uint64_t   step       = {};
+    };
+
+    // A run skips cells that equal those of the previous frame, then carries count cells;
+    // a keyframe is against cells of zeros, which the empty cells are
+    struct run_t {
+      uint32_t   skip       = {};
+      uint32_t   count      = {};
+    };
+
+    struct frame_header_t {
+      uint64_t    seq              = {};
+      uint64_t    config_version   = {};
+      request_t   request          = {};
+      uint64_t    resource         = {};
+      uint64_t    x                = {};
+      uint64_t    y                = {};
+      uint64_t    w                = {};
+      uint64_t    h                = {};
+      uint64_t    step             = {};
+      uint64_t    keyframe         = {};
+      uint64_t    runs_size        = {}; // bytes
+      uint64_t    stats_size       = {}; // sizeof(stats_t), checked by the viewer
+      uint64_t    cell_ind         = {};
+      uint64_t    cell_alive       = {};
+      uint64_t    cell_family      = {};
+      uint64_t    cell_age         = {};
+      uint64_t    cell_x           = {};
+      uint64_t    cell_y           = {};
+      uint64_t    resources_count  = {}; // of the cell, microbe then world
+      uint64_t    error_size       = {}; // bytes of frame_t::error
+    };
+
+    static_assert(std::is_trivially_copyable_v<stats_t>);
+    static_assert(std::is_trivially_copyable_v<frame_cell_t>);
+
+    // Blocks until all is written; MSG_NOSIGNAL, a viewer that went away is an error, not a signal
+    static bool write_all(int fd, const void* data, size_t size) {
+      TRACE_GENESIS;
+      auto ptr = static_cast<const uint8_t*>(data);
+      while (size) {
+        ssize_t count = ::send(fd, ptr, size, MSG_NOSIGNAL);
+        if (count < 0 && errno == EINTR) {
+          continue;
+        }
+        if (count <= 0) {
+          return false;
+        }
+        ptr  += count;
+        size -= count;
+      }
+      return true;
+    }
+
+    // Waits in steps of 100 ms, so that a peer that stalls mid message does not outlive stop
+    static bool read_all(int fd, void* data, size_t size, const std::atomic<bool>& stop) {
+      TRACE_GENESIS;
+      auto ptr = static_cast<uint8_t*>(data);
+      while (size) {
+        pollfd pfd = {.fd=fd, .events=POLLIN, .revents=0};
+        int ready = poll(&pfd, 1, 100);
+        if (stop) {
+          return false;
+        }
+        if (ready < 0 && errno != EINTR) {
+          return false;
+        }
+        if (ready <= 0) {
+          continue;
+        }
+        ssize_t count = ::recv(fd, ptr, size, 0);
+        if (count < 0 && (errno == EINTR || errno == EAGAIN)) {
+          continue;
+        }
+        if (count <= 0) {
+          return false;
+        }
+        ptr  += count;
+        size -= count;
+      }
+      return true;
+    }
+
+    static bool send(int fd, msg_t type, std::span<const uint8_t> payload = {}) {
+      TRACE_GENESIS;
+      header_t header = {.type=uint16_t(type), .size=payload.size()};
+      return write_all(fd, &header, sizeof(header)) && write_all(fd, payload.data(), payload.size());
+    }
+
+    static bool recv(int fd, header_t& header, std::vector<uint8_t>& payload, const std::atomic<bool>& stop) {
+      TRACE_GENESIS;
+      if (!read_all(fd, &header, sizeof(header), stop)) {
+        return false;
+      }
+      if (header.magic != MAGIC || header.version != VERSION || header.type >= MSG_COUNT || header.size > PAYLOAD_MAX) {
+        LOG_GENESIS(ERROR, "invalid message %x %u %u %zd", header.magic, header.version, header.type, header.size);
+        return false;
+      }
+      payload.resize(header.size);
+      return read_all(fd, payload.data(), payload.size(), stop);
+    }
+
+    static void append(std::vector<uint8_t>& data, const void* src, size_t size) {
+      auto ptr = static_cast<const uint8_t*>(src);
+      data.insert(data.end(), ptr, ptr + size);
+    }
+
+    static request_t save_request(const frame_request_t& request) {
+      return {
+        .resource = request.resource,
+        .cell_ind = request.cell_ind,
+        .x        = request.viewport.x,
+        .y        = request.viewport.y,
+        .w        = request.viewport.w,
+        .h        = request.viewport.h,
+        .step     = request.viewport.step,
+      };
+    }
+
+    static frame_request_t load_request(const request_t& request) {
+      return {
+        .resource = request.resource,
+        .cell_ind = request.cell_ind,
+        .viewport = {.x=request.x, .y=request.y, .w=request.w, .h=request.h, .step=request.step},
+      };
+    }
+
+    // The frame against base, the cells of the previous frame sent to this viewer, which
+    // becomes the frame's; a keyframe when the cells do not line up with base
+    static void save_frame(const frame_t& frame, frame_t::cells_t& base, std::vector<uint8_t>& payload) {
+      TRACE_GENESIS;
+      const auto& cells = frame.cells;
+      bool keyframe = base.size() != cells.size();
+      if (keyframe) {
+        base.assign(cells.size(), {});
+      }
+
+      frame_header_t header = {
+        .seq              = frame.seq,
+        .config_version   = frame.config_version,
+        .request          = save_request(frame.request),
+        .resource         = frame.resource,
+        .x                = frame.viewport.x,
+        .y                = frame.viewport.y,
+        .w                = frame.viewport.w,
+        .h                = frame.viewport.h,
+        .step             = frame.viewport.step,
+        .keyframe         = keyframe,
+        .runs_size        = {},
+        .stats_size       = sizeof(stats_t),
+        .cell_ind         = frame.cell_ind,
+        .cell_alive       = frame.cell.alive,
+        .cell_family      = frame.cell.family,
+        .cell_age         = frame.cell.age,
+        .cell_x           = frame.cell.pos.first,
+        .cell_y           = frame.cell.pos.second,
+        .resources_count  = frame.cell_ind < utils_t::npos ? frame.cell.resources_world.size() : 0,
+        .error_size       = frame.error.size(),
+      };
+
+      payload.resize(sizeof(header));
+      append(payload, &frame.stats, sizeof(stats_t));
+      append(payload, frame.cell.resources_microbe.data(), header.resources_count * sizeof(res_val_t));
+      append(payload, frame.cell.resources_world.data(), header.resources_count * sizeof(res_val_t));
+      append(payload, frame.error.data(), frame.error.size());
+
+      size_t runs_beg = payload.size();
+      for (size_t ind{}; ind < cells.size();) {
+        size_t skip_beg = ind;
+        while (ind < cells.size() && cells[ind] == base[ind]) {
+          ++ind;
+        }
+        size_t count_beg = ind;
+        while (ind < cells.size() && cells[ind] != base[ind]) {
+          base[ind] = cells[ind];
+          ++ind;
+        }
+        if (count_beg == ind) {
+          break;
+        }
+        run_t run = {.skip=uint32_t(count_beg - skip_beg), .count=uint32_t(ind - count_beg)};
+        append(payload, &run, sizeof(run));
+        append(payload, cells.data() + count_beg, (ind - count_beg) * sizeof(frame_cell_t));
+      }
+
+      header.runs_size = payload.size() - runs_beg;
+      std::memcpy(payload.data(), &header, sizeof(header));
+    }
+
+    // The frame from a payload of save_frame(), base holds the cells of the previous one and
+    // becomes the frame's; the config is left to the caller
+    static bool load_frame(std::span<const uint8_t> payload, frame_t& frame, frame_t::cells_t& base) {
+      TRACE_GENESIS;
+      frame_header_t header;
+      if (payload.size() < sizeof(header)) {
+        LOG_GENESIS(ERROR, "invalid frame size %zd", payload.size());
+        return false;
+      }
+      std::memcpy(&header, payload.data(), sizeof(header));
+
+      size_t cells_count = header.w * header.h;
+      size_t resources_size = header.resources_count * sizeof(res_val_t);
+      if (header.stats_size != sizeof(stats_t) || header.w > utils_t::npos / std::max<uint64_t>(header.h, 1)
+          || header.error_size > payload.size()
+          || payload.size() != sizeof(header) + sizeof(stats_t) + 2 * resources_size + header.error_size + header.runs_size) {
+        LOG_GENESIS(ERROR, "invalid frame header %zd %zd %zd", header.stats_size, cells_count, payload.size());
+        return false;
+      }
+
+      frame.seq                = header.seq;
+      frame.config_version     = header.config_version;
+      frame.request            = load_request(header.request);
+      frame.resource           = header.resource;
+      frame.viewport           = {.x=header.x, .y=header.y, .w=header.w, .h=header.h, .step=header.step};
+      frame.cell_ind           = header.cell_ind;
+      frame.cell.alive         = header.cell_alive;
+      frame.cell.family        = header.cell_family;
+      frame.cell.age           = header.cell_age;
+      frame.cell.pos           = {header.cell_x, header.cell_y};
+
+      const uint8_t* ptr = payload.data() + sizeof(header);
+      std::memcpy(&frame.stats, ptr, sizeof(stats_t));
+      ptr += sizeof(stats_t);
+      frame.cell.resources_microbe.resize(header.resources_count);
+      frame.cell.resources_world.resize(header.resources_count);
+      std::memcpy(frame.cell.resources_microbe.data(), ptr, resources_size);
+      std::memcpy(frame.cell.resources_world.data(), ptr + resources_size, resources_size);
+      ptr += 2 * resources_size;
+      frame.error.assign(reinterpret_cast<const char*>(ptr), header.error_size);
+      ptr += header.error_size;
+
+      if (header.keyframe) {
+        base.assign(cells_count, {});
+      } else if (base.size() != cells_count) {
+        LOG_GENESIS(ERROR, "delta frame of %zd cells after %zd", cells_count, base.size());
+        return false;
+      }
+
+      const uint8_t* end = payload.data() + payload.size();
+      for (size_t ind{}; ptr < end;) {
+        run_t run;
+        if (size_t(end - ptr) < sizeof(run)) {
+          LOG_GENESIS(ERROR, "invalid run at %zd", ind);
+          return false;
+        }
+        std::memcpy(&run, ptr, sizeof(run));
+        ptr += sizeof(run);
+        ind += run.skip;
+        if (ind + run.count > cells_count || size_t(end - ptr) < run.count * sizeof(frame_cell_t)) {
+          LOG_GENESIS(ERROR, "invalid run at %zd", ind);
+          return false;
+        }
+        std::memcpy(base.data() + ind, ptr, run.count * sizeof(frame_cell_t));
+        ptr += run.count * sizeof(frame_cell_t);
+        ind += run.count;
+      }
+
+      frame.cells = base;
+      return true;
+    }
+
+    static bool socket_address(const std::string& socket_path, sockaddr_un& address) {
+      address = {};
+      address.sun_family = AF_UNIX;
+      if (socket_path.size() >= sizeof(address.sun_path)) {
+        LOG_GENESIS(ERROR, "socket path too long %s", socket_path.c_str());
+        return false;
+      }
+      std::memcpy(address.sun_path, socket_path.c_str(), socket_path.size() + 1);
+      return true;
+    }
+  };
+
+  ////////////////////////////////////////////////////////////////////////////////
+
+  // The frames of a genesis_server; the commands are forwarded to it. Reconnects while the
+  // server is away, the viewer keeps the last frame meanwhile.
+  class world_remote_t : public world_source_t {
+    using protocol_t = view_protocol_t;
+
+    std::string            _socket_path;
+    int                    _fd = -1;
+    frame_t::config_p_t    _config;
+    uint64_t               _config_version = {};
+    frame_t::cells_t       _cells;   // of the last frame, the base of the next one
+    std::vector<uint8_t>   _payload;
+
+    bool connect() {
+      sockaddr_un address;
+      if (!protocol_t::socket_address(_socket_path, address)) {
+        return false;
+      }
+      _fd = socket(AF_UNIX, SOCK_STREAM, 0);
+      if (_fd < 0 || ::connect(_fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+        disconnect();
+        return false;
+      }
+      _cells.clear();
+      _config = {};
+      return true;
+    }
+
+    void disconnect() {
+      if (_fd >= 0) {
+        close(_fd);
+      }
+      _fd = -1;
+    }
+
+    bool command(std::atomic<bool>& flag, protocol_t::msg_t type) {
+      return !flag.exchange(false) || protocol_t::send(_fd, type);
+    }
+
+    bool exchange() {
+      if (!command(_need_pause, protocol_t::MSG_PAUSE)
+          || !command(_need_update, protocol_t::MSG_RELOAD)
+          || !command(_need_save, protocol_t::MSG_SAVE)
+          || !command(_need_trace, protocol_t::MSG_TRACE)) {
+        return false;
+      }
+
+      frame_request_t request;
+      if (!_exchange.requested(request)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        return true;
+      }
+
+      auto request_data = protocol_t::save_request(request);
+      protocol_t::header_t header;
+      if (!protocol_t::send(_fd, protocol_t::MSG_FRAME, {reinterpret_cast<const uint8_t*>(&request_data), sizeof(request_data)})
+          || !protocol_t::recv(_fd, header, _payload, _stop) || header.type != protocol_t::MSG_FRAME) {
+        return false;
+      }
+
+      auto& frame = _exchange.back();
+      if (!protocol_t::load_frame(_payload, frame, _cells)) {
+        return false;
+      }
+
+      if (!_config || _config_version != frame.config_version) {
+        if (!protocol_t::send(_fd, protocol_t::MSG_CONFIG)
+            || !protocol_t::recv(_fd, header, _payload, _stop) || header.type != protocol_t::MSG_CONFIG) {
+          return false;
+        }
+        auto config = std::make_shared<config_t>();
+        auto json = nlohmann::json::parse(_payload.begin(), _payload.end(), nullptr, false);
+        if (json.is_discarded() || !config_json_wrapper_t(*config).load(json)) {
+          LOG_GENESIS(ERROR, "invalid config from %s", _socket_path.c_str());
+          return false;
+        }
+        _config = config;
+        _config_version = frame.config_version;
+      }
+
+      if (frame.resource >= _config->resources.size() || frame.cell.resources_world.size() > _config->resources.size()) {
+        LOG_GENESIS(ERROR, "frame does not match the config %zd", frame.resource);
+        return false;
+      }
+
+      frame.config = _config;
+      _exchange.publish();
+      return true;
+    }
+
+   public:
+    void init(const std::string& socket_path) {
+      _socket_path = socket_path;
+    }
+
+    void update() override {
+      while (!_stop) {
+        if (_fd < 0 && !connect()) {
+          std::this_thread::sleep_for(std::chrono::milliseconds(100));
+          continue;
+        }
+        if (!exchange()) {
+          disconnect();
+        }
+      }
+      disconnect();
+    }
+  };
+
+}
+
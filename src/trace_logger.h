@@ -0,0 +1,196 @@
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+
+
+#define TRACE_SCOPE(_category, _name, _cond)   \
+  trace_n::scope_t trace_scope(_category, _name, _cond)
+
+#define TRACE_EVENT(_category, _cond, ...)   \
+  trace_n::event(_category, _cond, __VA_ARGS__)
+
+
+
+namespace trace_n {
+
+  // events each thread keeps, the older ones are overwritten
+  inline size_t ring_size = 1 << 20;
+
+  inline uint64_t now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+
+  // no initializers, the pages of a ring are committed as the events are written
+  struct event_t {
+    inline static constexpr uint32_t INSTANT = uint32_t(-1);
+
+    const char*   name;       // static string: the function, or the format of a log
+    uint64_t      time;       // ns, steady_clock
+    uint32_t      duration;   // ns, saturated, INSTANT for an event without one
+    uint32_t      category;
+  };
+
+  // Written only by its own thread, so a push is a store and a release of the head;
+  // a dump taken while the thread is between events sees whole events.
+  struct ring_t {
+    using events_t = std::unique_ptr<event_t[]>;
+
+    size_t                  size     = ring_size;
+    events_t                events   = std::make_unique_for_overwrite<event_t[]>(size);
+    std::atomic<uint64_t>   head     = {};
+    uint32_t                tid      = {};
+
+    void push(const event_t& event) {
+      uint64_t head_val = head.load(std::memory_order_relaxed);
+      events[head_val % size] = event;
+      head.store(head_val + 1, std::memory_order_release);
+    }
+  };
+
+  // rings of the threads that exited stay registered until the dump
+  struct registry_t {
+    std::mutex                              mutex   = {};
+    std::vector<std::shared_ptr<ring_t>>    rings   = {};
+
+    static registry_t& instance() {
+      static registry_t registry;
+      return registry;
+    }
+  };
+
+  // the ring of the calling thread, allocated with its first event
+  inline ring_t& ring() {
+    thread_local std::shared_ptr<ring_t> ring = [] {
+      auto& registry = registry_t::instance();
+      std::lock_guard lock(registry.mutex);
+      auto ring = std::make_shared<ring_t>();
+      ring->tid = registry.rings.size() + 1;
+      registry.rings.push_back(ring);
+      return ring;
+    }();
+    return *ring;
+  }
+
+  // the format is the name of the event, the arguments are not recorded
+  inline void event(uint32_t category, bool cond, const char* format, ...) {
+    if (cond) {
+      ring().push({.name=format, .time=now(), .duration=event_t::INSTANT, .category=category});
+    }
+  }
+
+  struct scope_t {
+    const char*   name       = {};
+    uint32_t      category   = {};
+    uint64_t      time       = {}; // 0 when the scope is not recorded
+
+    scope_t(uint32_t category, const char* name, bool cond) : name(name), category(category) {
+      if (cond) {
+        time = now();
+      }
+    }
+
+    ~scope_t() {
+      if (time) {
+        uint64_t duration = std::min<uint64_t>(now() - time, event_t::INSTANT - 1);
+        ring().push({.name=name, .time=time, .duration=uint32_t(duration), .category=category});
+      }
+    }
+  };
+
+  // Drops the recorded events; only while no thread is recording.
+  inline void clear() {
+    auto& registry = registry_t::instance();
+    std::lock_guard lock(registry.mutex);
+    for (auto& ring : registry.rings) {
+      ring->head.store(0, std::memory_order_release);
+    }
+  }
+
+  // Writes the recorded events as Chrome trace JSON, which Perfetto and chrome://tracing
+  // open; categories are the names of the category ids. Nothing is written when nothing
+  // was recorded. The threads may go on recording: each ring is copied, then the events
+  // its thread overwrote meanwhile, the one it may be writing included, are dropped.
+  inline bool dump(const std::string& file_name, const std::vector<std::string>& categories) {
+    auto& registry = registry_t::instance();
+    std::lock_guard lock(registry.mutex);
+
+    if (registry.rings.empty()) {
+      return true;
+    }
+
+    std::vector<std::pair<uint32_t, std::vector<event_t>>> rings;
+    for (const auto& ring : registry.rings) {
+      uint64_t head = ring->head.load(std::memory_order_acquire);
+      uint64_t beg  = head - std::min<uint64_t>(head, ring->size);
+      std::vector<event_t> events(head - beg);
+      for (uint64_t ind = beg; ind < head; ++ind) {
+        events[ind - beg] = ring->events[ind % ring->size];
+      }
+      // the thread may have gone on meanwhile, into the oldest slots
+      std::atomic_thread_fence(std::memory_order_acquire);
+      uint64_t head_now = ring->head.load(std::memory_order_relaxed);
+      uint64_t kept_beg = std::max(beg, head_now + 1 - std::min<uint64_t>(head_now + 1, ring->size));
+      events.erase(events.begin(), events.begin() + std::min<uint64_t>(events.size(), kept_beg - beg));
+      rings.push_back({ring->tid, std::move(events)});
+    }
+
+    FILE* file = fopen(file_name.c_str(), "w");
+    if (!file) {
+      return false;
+    }
+
+    auto write_string = [&](const char* str) {
+      fputc('"', file);
+      for (; *str; ++str) {
+        if (*str == '"' || *str == '\\') {
+          fputc('\\', file);
+          fputc(*str, file);
+        } else if ((unsigned char) *str < 0x20) {
+          fprintf(file, "\\u%04x", *str);
+        } else {
+          fputc(*str, file);
+        }
+      }
+      fputc('"', file);
+    };
+
+    uint64_t time_beg = uint64_t(-1);
+    for (const auto& [tid, events] : rings) {
+      for (const auto& event : events) {
+        time_beg = std::min(time_beg, event.time);
+      }
+    }
+
+    fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+    const char* separator = "\n";
+    for (const auto& [tid, events] : rings) {
+      for (const auto& event : events) {
+        fprintf(file, "%s{\"name\":", separator);
+        write_string(event.name);
+        fprintf(file, ",\"cat\":");
+        write_string(event.category < categories.size() ? categories[event.category].c_str() : "");
+        fprintf(file, ",\"pid\":1,\"tid\":%u,\"ts\":%.3f", tid, (event.time - time_beg) / 1e3);
+        if (event.duration == event_t::INSTANT) {
+          fprintf(file, ",\"ph\":\"i\",\"s\":\"t\"}");
+        } else {
+          fprintf(file, ",\"ph\":\"X\",\"dur\":%.3f}", event.duration / 1e3);
+        }
+        separator = ",\n";
+      }
+    }
+    fprintf(file, "\n]}\n");
+
+    return fclose(file) == 0;
+  }
+
+}
+